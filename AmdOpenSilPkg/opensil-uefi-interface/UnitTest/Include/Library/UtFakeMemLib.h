@@ -0,0 +1,272 @@
+/* Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved. */
+// SPDX-License-Identifier: MIT
+/**
+ * @file  UtFakeMemLib.h
+ * @brief Sparse fake address-space engine shared by the MMIO, IO, PCIe and SMN fakes
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define UT_FAKE_PAGE_SHIFT          12
+#define UT_FAKE_PAGE_SIZE           (1ul << UT_FAKE_PAGE_SHIFT)
+#define UT_FAKE_PAGE_MASK           (UT_FAKE_PAGE_SIZE - 1)
+
+#define UT_FAKE_SPACE_MMIO          "MMIO"
+#define UT_FAKE_SPACE_IO            "IO"
+#define UT_FAKE_SPACE_PCIE          "PCIE"
+#define UT_FAKE_SPACE_SMN           "SMN"
+
+/// Address of an SMN register in the UT_FAKE_SPACE_SMN address space
+#define UT_FAKE_SMN_ADDRESS(SegmentNumber, IohcBus, SmnAddress) \
+  ((((uint64_t)(SegmentNumber) & 0xFFFFFF) << 40) | (((uint64_t)(IohcBus) & 0xFF) << 32) | (uint32_t)(SmnAddress))
+
+#define UT_FAKE_IMAGE_SIGNATURE     0x49465455    // "UTFI"
+#define UT_FAKE_IMAGE_VERSION       1
+
+#pragma pack (push, 1)
+
+/**
+ * Register image file layout (see UtFakeImageLoad):
+ *   UT_FAKE_IMAGE_HEADER
+ *   UT_FAKE_IMAGE_REGION [RegionCount]    at RegionOffset
+ *   region data                           at each DataOffset (page aligned, so the data can be used in place)
+ */
+typedef struct {
+  uint32_t  Signature;                    ///< UT_FAKE_IMAGE_SIGNATURE
+  uint16_t  Version;                      ///< UT_FAKE_IMAGE_VERSION
+  uint16_t  HeaderSize;                   ///< sizeof (UT_FAKE_IMAGE_HEADER)
+  uint32_t  RegionCount;
+  uint32_t  RegionOffset;                 ///< File offset of the region table
+} UT_FAKE_IMAGE_HEADER;
+
+typedef struct {
+  char      Space[16];                    ///< Address space name (e.g. UT_FAKE_SPACE_PCIE), NUL padded
+  uint64_t  Base;                         ///< First address of the region in that space
+  uint64_t  Length;                       ///< Region length in bytes
+  uint64_t  DataOffset;                   ///< File offset of the region contents
+} UT_FAKE_IMAGE_REGION;
+
+#pragma pack (pop)
+
+typedef struct _UT_FAKE_SPACE UT_FAKE_SPACE;
+
+/// Fake state kept outside the address spaces (e.g. the openSIL host memory block)
+typedef struct {
+  const char  *Name;
+  void        (*Snapshot) (void);         ///< Capture the current state
+  void        (*Restore) (void);          ///< Return to the captured state
+  void        (*Discard) (void);          ///< Release the captured state
+  void        (*Reset) (void);            ///< Return to the initial state between iterations (optional)
+} UT_FAKE_STATE_PROVIDER;
+
+/// Called before every UtFakeSpaceRead (see UtFakeSetReadHook)
+typedef void (*UT_FAKE_READ_HOOK) (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address
+  );
+
+/**
+ * Called when a modelled register is read. Value holds the stored register
+ * contents on entry; whatever it holds on return is what the reader sees.
+ */
+typedef void (*UT_FAKE_READ_HANDLER) (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint64_t      *Value,
+  void          *Context
+  );
+
+/**
+ * Called when a modelled register is written, after the read-only and
+ * write-1-to-clear masks were applied. Returns the value to store, from
+ * which the self-clearing bits are then cleared.
+ */
+typedef uint64_t (*UT_FAKE_WRITE_HANDLER) (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint64_t      OldValue,
+  uint64_t      NewValue,
+  void          *Context
+  );
+
+/// Side effects of a register (see UtFakeSpaceAddRegisters)
+typedef struct {
+  uint8_t               Width;            ///< Register width in bytes: 1, 2, 4 or 8
+  uint64_t              ReadOnlyMask;     ///< Bits writes cannot change
+  uint64_t              Write1ClearMask;  ///< Bits cleared by writing 1, unchanged by writing 0
+  uint64_t              SelfClearMask;    ///< Bits that read back as 0 after a write
+  UT_FAKE_READ_HANDLER  OnRead;           ///< Optional
+  UT_FAKE_WRITE_HANDLER OnWrite;          ///< Optional
+  void                  *Context;         ///< Passed to OnRead and OnWrite
+} UT_FAKE_REGISTER;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+UT_FAKE_SPACE *
+UtFakeSpaceGet (
+  const char  *Name
+  );
+
+void
+UtFakeSpaceSetDefaultValue (
+  UT_FAKE_SPACE *Space,
+  uint8_t       Value
+  );
+
+void
+UtFakeSpaceReset (
+  UT_FAKE_SPACE *Space
+  );
+
+void
+UtFakeResetAll (
+  void
+  );
+
+bool
+UtFakeSnapshot (
+  void
+  );
+
+bool
+UtFakeRestore (
+  void
+  );
+
+void
+UtFakeSnapshotDiscard (
+  void
+  );
+
+bool
+UtFakeRegisterStateProvider (
+  const UT_FAKE_STATE_PROVIDER  *Provider
+  );
+
+bool
+UtFakeSpaceAddRegisters (
+  UT_FAKE_SPACE           *Space,
+  uint64_t                Base,
+  uint64_t                Length,
+  const UT_FAKE_REGISTER  *Register
+  );
+
+void
+UtFakeSpaceRemoveRegisters (
+  UT_FAKE_SPACE *Space
+  );
+
+void
+UtFakeSetReadHook (
+  UT_FAKE_READ_HOOK Hook
+  );
+
+size_t
+UtFakeSpaceGetPageCount (
+  UT_FAKE_SPACE *Space
+  );
+
+void
+UtFakeSpaceRead (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  void          *Buffer,
+  size_t        Length
+  );
+
+void
+UtFakeSpaceWrite (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  const void    *Buffer,
+  size_t        Length
+  );
+
+void
+UtFakeSpaceStore (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  const void    *Buffer,
+  size_t        Length
+  );
+
+void
+UtFakeSpaceLoad (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  void          *Buffer,
+  size_t        Length
+  );
+
+uint8_t
+UtFakeSpaceRead8 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address
+  );
+
+uint16_t
+UtFakeSpaceRead16 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address
+  );
+
+uint32_t
+UtFakeSpaceRead32 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address
+  );
+
+uint64_t
+UtFakeSpaceRead64 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address
+  );
+
+void
+UtFakeSpaceWrite8 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint8_t       Value
+  );
+
+void
+UtFakeSpaceWrite16 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint16_t      Value
+  );
+
+void
+UtFakeSpaceWrite32 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint32_t      Value
+  );
+
+void
+UtFakeSpaceWrite64 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint64_t      Value
+  );
+
+bool
+UtFakeImageLoad (
+  const char  *Path
+  );
+
+void
+UtFakeImageUnloadAll (
+  void
+  );
+
+#ifdef __cplusplus
+}
+#endif
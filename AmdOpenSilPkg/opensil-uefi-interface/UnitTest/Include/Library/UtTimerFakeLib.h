@@ -0,0 +1,64 @@
+/* Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved. */
+// SPDX-License-Identifier: MIT
+/**
+ * @file  UtTimerFakeLib.h
+ * @brief Virtual-time clock for the fake address spaces
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <Library/UtFakeMemLib.h>
+
+#define UT_TIMER_FAKE_DEFAULT_POLL_TIME   1000      ///< Nanoseconds a register read takes by default
+#define UT_TIMER_FAKE_ACPI_PM_FREQUENCY   3579545   ///< ACPI PM timer frequency in Hz
+
+/// Function run when the virtual clock reaches the time it was scheduled for
+typedef void (*UT_TIMER_FAKE_CALLBACK) (
+  void  *Context
+  );
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64_t
+UtTimerFakeGetTime (
+  void
+  );
+
+void
+UtTimerFakeAdvance (
+  uint64_t  Nanoseconds
+  );
+
+void
+UtTimerFakeStall (
+  uint64_t  Microseconds
+  );
+
+void
+UtTimerFakeSetPollTime (
+  uint64_t  Nanoseconds
+  );
+
+bool
+UtTimerFakeSchedule (
+  uint64_t                Delay,
+  UT_TIMER_FAKE_CALLBACK  Callback,
+  void                    *Context
+  );
+
+bool
+UtTimerFakeAddCounter (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint8_t       Width,
+  uint32_t      Frequency
+  );
+
+#ifdef __cplusplus
+}
+#endif
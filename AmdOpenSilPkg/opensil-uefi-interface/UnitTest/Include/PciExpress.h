@@ -62,6 +62,11 @@ xUSLPciExpressWrite64 (
   uint64_t Value
   );
 
+void
+UtPciExpressFakeSetDefaultValue (
+  uint8_t Value
+  );
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,6 +9,13 @@
 // SPDX-License-Identifier: MIT
 
 #pragma once
+#if !defined(_MSC_VER)
+//
+// Copy of the Windows C runtime header; other compilers use the string.h of
+// their own C library.
+//
+#include_next <string.h>
+#else
 #ifndef _INC_STRING // include guard for 3rd party interop
 #define _INC_STRING
 
@@ -593,3 +600,4 @@ _UCRT_RESTORE_CLANG_WARNINGS
 #pragma warning(pop) // _UCRT_DISABLED_WARNINGS
 #endif // !__midl
 #endif // _INC_STRING
+#endif // !_MSC_VER
@@ -0,0 +1,245 @@
+/* Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved. */
+// SPDX-License-Identifier: MIT
+/**
+ * @file  UtFakeImage.c
+ * @brief Register image preload for the fake address spaces
+ *
+ * @details A register image (UT_FAKE_IMAGE_HEADER) holds dumps of real
+ *          register ranges, e.g. PCI config space, the FCH ACPI MMIO block
+ *          or SMN ranges. Loading an image maps the file read-only and backs
+ *          each region's address range with the mapping, so loading only
+ *          reads the region table; register contents are paged in by the
+ *          OS on first access and copied by the engine on first write.
+ *
+ *          An iteration selects an image with the "FakeImage" key of its
+ *          test configuration. A relative path is resolved against the
+ *          directory of the configuration file.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <UtBaseLib.h>
+#include <UtLogLib.h>
+#include <Library/UtFakeMemLib.h>
+#include "UtFakeMemLibInternal.h"
+
+#define UT_FAKE_IMAGE_CONFIG_KEY    "FakeImage"
+
+typedef struct _UT_FAKE_IMAGE UT_FAKE_IMAGE;
+
+struct _UT_FAKE_IMAGE {
+  char          Path[AMD_UNIT_TEST_MAX_PATH_LENGTH];
+  const uint8_t *Base;
+  uint64_t      Size;
+  bool          FromConfig;               ///< Loaded through the "FakeImage" iteration key
+  UT_FAKE_IMAGE *Next;
+};
+
+static UT_FAKE_IMAGE *mFakeImages = NULL;
+
+/**
+ * UtFakeImageUnload
+ * @brief Removes an image from the address spaces and unmaps it.
+ *
+ * @param Image  Loaded image (freed on return)
+ */
+static
+void
+UtFakeImageUnload (
+  UT_FAKE_IMAGE *Image
+  )
+{
+  UT_FAKE_IMAGE **Link;
+
+  for (Link = &mFakeImages; *Link != NULL; Link = &(*Link)->Next) {
+    if (*Link == Image) {
+      *Link = Image->Next;
+      break;
+    }
+  }
+  UtFakeRemoveBacking (Image);
+  UtFakeUnmapFile (Image->Base, Image->Size);
+  free (Image);
+}
+
+/**
+ * UtFakeImageOpen
+ * @brief Maps an image and backs its regions.
+ *
+ * @param Path        Image file path
+ * @param FromConfig  Image is selected by the iteration configuration
+ *
+ * @return Loaded image, or NULL if the file cannot be mapped or is not a valid image.
+ */
+static
+UT_FAKE_IMAGE *
+UtFakeImageOpen (
+  const char  *Path,
+  bool        FromConfig
+  )
+{
+  UT_FAKE_IMAGE               *Image;
+  const UT_FAKE_IMAGE_HEADER  *Header;
+  const UT_FAKE_IMAGE_REGION  *Region;
+  UT_FAKE_SPACE               *Space;
+  char                        SpaceName[sizeof (Region->Space) + 1];
+  uint32_t                    Index;
+
+  if (strlen (Path) >= AMD_UNIT_TEST_MAX_PATH_LENGTH) {
+    return NULL;
+  }
+  Image = (UT_FAKE_IMAGE*) calloc (1, sizeof (UT_FAKE_IMAGE));
+  if (Image == NULL) {
+    return NULL;
+  }
+  strcpy (Image->Path, Path);
+  Image->FromConfig = FromConfig;
+  Image->Base       = (const uint8_t*) UtFakeMapFile (Path, &Image->Size);
+  if (Image->Base == NULL) {
+    free (Image);
+    return NULL;
+  }
+  Image->Next = mFakeImages;
+  mFakeImages = Image;
+
+  Header = (const UT_FAKE_IMAGE_HEADER*) Image->Base;
+  if ((Image->Size < sizeof (UT_FAKE_IMAGE_HEADER)) ||
+      (Header->Signature != UT_FAKE_IMAGE_SIGNATURE) ||
+      (Header->Version != UT_FAKE_IMAGE_VERSION) ||
+      (Header->RegionOffset > Image->Size) ||
+      ((uint64_t)Header->RegionCount * sizeof (UT_FAKE_IMAGE_REGION) > Image->Size - Header->RegionOffset)) {
+    UtFakeImageUnload (Image);
+    return NULL;
+  }
+
+  Region = (const UT_FAKE_IMAGE_REGION*)(Image->Base + Header->RegionOffset);
+  for (Index = 0; Index < Header->RegionCount; Index++, Region++) {
+    if ((Region->DataOffset > Image->Size) ||
+        (Region->Length > Image->Size - Region->DataOffset) ||
+        ((Region->Length != 0) && (Region->Base + (Region->Length - 1) < Region->Base))) {
+      UtFakeImageUnload (Image);
+      return NULL;
+    }
+    memcpy (SpaceName, Region->Space, sizeof (Region->Space));
+    SpaceName[sizeof (Region->Space)] = '\0';
+    Space = UtFakeSpaceGet (SpaceName);
+    if ((Space == NULL) ||
+        !UtFakeSpaceAddBacking (Space, Region->Base, Image->Base + Region->DataOffset, Region->Length, Image)) {
+      UtFakeImageUnload (Image);
+      return NULL;
+    }
+  }
+  return Image;
+}
+
+/**
+ * UtFakeImageLoad
+ * @brief Loads a register image as the initial contents of the fake address spaces.
+ *
+ * @details Addresses covered by the image read as the image until they are
+ *          written; a reset returns them to the image, not to the default
+ *          value. Where regions overlap, later images take precedence over
+ *          earlier ones, and later regions of an image over earlier ones.
+ *
+ * @param Path  Image file path
+ *
+ * @retval true   Image loaded
+ * @retval false  The file cannot be mapped or is not a valid image
+ */
+bool
+UtFakeImageLoad (
+  const char  *Path
+  )
+{
+  return UtFakeImageOpen (Path, false) != NULL;
+}
+
+/**
+ * UtFakeImageUnloadAll
+ * @brief Unloads every register image.
+ *
+ * @details Pages already written keep their contents.
+ */
+void
+UtFakeImageUnloadAll (
+  void
+  )
+{
+  while (mFakeImages != NULL) {
+    UtFakeImageUnload (mFakeImages);
+  }
+}
+
+/**
+ * UtFakeImageSetup
+ * @brief Loads the register image selected by the iteration's "FakeImage" key.
+ *
+ * @details Registered with UtBaseLib by the engine constructor, so it runs
+ *          before each iteration's TestPrerequisite. A relative path is
+ *          relative to the directory of the test configuration file. The
+ *          image of the previous iteration is kept if both iterations select
+ *          the same file.
+ *
+ * @param Ut  Test framework
+ */
+void
+UtFakeImageSetup (
+  AMD_UNIT_TEST_FRAMEWORK *Ut
+  )
+{
+  cJSON           *Item;
+  UT_FAKE_IMAGE   *Image;
+  UT_FAKE_IMAGE   *Next;
+  char            Path[AMD_UNIT_TEST_MAX_PATH_LENGTH];
+  const char      *Separator;
+  const char      *Slash;
+  int             Length;
+
+  if ((Ut == NULL) || (Ut->TestConfigIteration == NULL)) {
+    return;
+  }
+
+  Path[0] = '\0';
+  Item = cJSON_GetObjectItemCaseSensitive (Ut->TestConfigIteration, UT_FAKE_IMAGE_CONFIG_KEY);
+  if (cJSON_IsString (Item) && (Item->valuestring != NULL) && (Item->valuestring[0] != '\0')) {
+    Separator = strrchr (Ut->TestConfigFile, '\\');
+    Slash     = strrchr (Ut->TestConfigFile, '/');
+    if ((Separator == NULL) || ((Slash != NULL) && (Slash > Separator))) {
+      Separator = Slash;
+    }
+    if ((Separator == NULL) || (Item->valuestring[0] == '\\') || (Item->valuestring[0] == '/') ||
+        (Item->valuestring[1] == ':')) {
+      Length = snprintf (Path, sizeof (Path), "%s", Item->valuestring);
+    } else {
+      Length = snprintf (Path, sizeof (Path), "%.*s%s",
+        (int)(Separator - Ut->TestConfigFile + 1), Ut->TestConfigFile, Item->valuestring);
+    }
+    if ((Length < 0) || (Length >= (int) sizeof (Path))) {
+      Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+        "Register image path '%s' is too long.", Item->valuestring);
+      UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
+      return;
+    }
+  }
+
+  for (Image = mFakeImages; Image != NULL; Image = Next) {
+    Next = Image->Next;
+    if (Image->FromConfig) {
+      if (strcmp (Image->Path, Path) == 0) {
+        return;
+      }
+      UtFakeImageUnload (Image);
+    }
+  }
+
+  if (Path[0] == '\0') {
+    return;
+  }
+  if (UtFakeImageOpen (Path, true) == NULL) {
+    Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+      "Failed to load register image '%s'. Test status was set to ABORTED.", Path);
+    UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
+    return;
+  }
+  Ut->Log(AMD_UNIT_TEST_LOG_INFO, __FUNCTION__, __LINE__, "Register image '%s' loaded.", Path);
+}
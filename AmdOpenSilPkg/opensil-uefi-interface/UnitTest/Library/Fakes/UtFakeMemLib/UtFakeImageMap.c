@@ -0,0 +1,108 @@
+/* Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved. */
+// SPDX-License-Identifier: MIT
+/**
+ * @file  UtFakeImageMap.c
+ * @brief Read-only file mapping for register images
+ *
+ * @details Kept apart from the rest of UtFakeMemLib: the OS headers below
+ *          clash with the UEFI headers pulled in by UtBaseLib.h.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/**
+ * UtFakeMapFile
+ * @brief Maps a whole file read-only.
+ *
+ * @details Nothing is read here; the OS brings pages in as they are touched.
+ *
+ * @param Path  File path
+ * @param Size  Receives the file size
+ *
+ * @return Base of the mapping, or NULL on failure (or for an empty file).
+ */
+const void *
+UtFakeMapFile (
+  const char  *Path,
+  uint64_t    *Size
+  )
+{
+#if defined(_WIN32)
+  HANDLE          File;
+  HANDLE          Mapping;
+  LARGE_INTEGER   FileSize;
+  const void      *Base;
+
+  File = CreateFileA (Path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (File == INVALID_HANDLE_VALUE) {
+    return NULL;
+  }
+  if (!GetFileSizeEx (File, &FileSize) || (FileSize.QuadPart == 0)) {
+    CloseHandle (File);
+    return NULL;
+  }
+  Mapping = CreateFileMappingA (File, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle (File);
+  if (Mapping == NULL) {
+    return NULL;
+  }
+  Base = MapViewOfFile (Mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle (Mapping);
+  if (Base == NULL) {
+    return NULL;
+  }
+  *Size = (uint64_t) FileSize.QuadPart;
+  return Base;
+#else
+  int             File;
+  struct stat     FileStat;
+  void            *Base;
+
+  File = open (Path, O_RDONLY);
+  if (File < 0) {
+    return NULL;
+  }
+  if ((fstat (File, &FileStat) != 0) || (FileStat.st_size == 0)) {
+    close (File);
+    return NULL;
+  }
+  Base = mmap (NULL, (size_t) FileStat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+  close (File);
+  if (Base == MAP_FAILED) {
+    return NULL;
+  }
+  *Size = (uint64_t) FileStat.st_size;
+  return Base;
+#endif
+}
+
+/**
+ * UtFakeUnmapFile
+ * @brief Unmaps a file mapped by UtFakeMapFile.
+ *
+ * @param Base  Base of the mapping
+ * @param Size  File size returned by UtFakeMapFile
+ */
+void
+UtFakeUnmapFile (
+  const void  *Base,
+  uint64_t    Size
+  )
+{
+#if defined(_WIN32)
+  (void) Size;
+  UnmapViewOfFile (Base);
+#else
+  munmap ((void*) Base, (size_t) Size);
+#endif
+}
@@ -0,0 +1,1651 @@
+/* Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved. */
+// SPDX-License-Identifier: MIT
+/**
+ * @file  UtFakeMemLib.c
+ * @brief Sparse fake address-space engine
+ *
+ * @details Every fake address space (MMIO, IO, PCIe, SMN, ...) is a full
+ *          64-bit byte-addressable space backed by a four level radix page
+ *          table. 4 KB pages are allocated on first write; reads from pages
+ *          that were never written return the space's default value.
+ *          Each thread keeps the last page it touched in every space, so
+ *          repeated accesses to the same register block skip the table walk.
+ *
+ *          Every page written since the last reset (or restore) is linked on
+ *          its space's dirty list. UtFakeResetAll () releases only those
+ *          pages, so the cost of a reset between iterations is proportional
+ *          to the pages the iteration touched, not to the size of the
+ *          address space.
+ *
+ *          UtFakeSnapshot () takes a reference on every live page instead of
+ *          copying it. The first write to a shared page afterwards copies it
+ *          (copy-on-write) and remembers the original, so UtFakeRestore ()
+ *          only has to put the originals of the dirty pages back.
+ *
+ *          A space can also be backed by read-only memory, e.g. a register
+ *          image mapped by UtFakeImageLoad (). Reads from pages that were
+ *          never written come straight from the backing; the first write
+ *          copies the backing into a private page.
+ *
+ *          Registers with side effects (read-only, write-1-to-clear and
+ *          self-clearing bits, read and write callbacks) are attached to
+ *          address ranges by UtFakeSpaceAddRegisters (). They are found
+ *          through a second radix table holding, for each page with at least
+ *          one such register, a bitmap of the bytes they cover. Spaces without
+ *          registers take a single branch to the plain byte store. Each
+ *          thread also remembers whether the last page it touched in every
+ *          space has registers, so accesses to pages without them skip the
+ *          table walk as well.
+ *
+ *          The engine is not thread-safe with respect to page allocation;
+ *          the fakes built on it were not either.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <UtBaseLib.h>
+#include <Library/UtFakeMemLib.h>
+#include "UtFakeMemLibInternal.h"
+
+#define UT_FAKE_LEVEL_BITS          13
+#define UT_FAKE_LEVEL_COUNT         4      // 4 * 13 bits of page number + 12 bits of offset = 64 bits
+#define UT_FAKE_LEVEL_ENTRIES       (1ul << UT_FAKE_LEVEL_BITS)
+#define UT_FAKE_LEVEL_MASK          (UT_FAKE_LEVEL_ENTRIES - 1)
+#define UT_FAKE_MAX_SPACES          16
+#define UT_FAKE_MAX_NAME_LENGTH     16     // Same as UT_FAKE_IMAGE_REGION.Space
+#define UT_FAKE_MAX_PROVIDERS       8
+#define UT_FAKE_PAGE_REGISTERS      8      // Register ranges a page has room for at first; grows as needed
+
+#if defined(_MSC_VER)
+#define UT_FAKE_THREAD_LOCAL        __declspec(thread)
+#else
+#define UT_FAKE_THREAD_LOCAL        __thread
+#endif
+
+typedef struct _UT_FAKE_PAGE UT_FAKE_PAGE;
+
+struct _UT_FAKE_PAGE {
+  uint8_t       Data[UT_FAKE_PAGE_SIZE];
+  uint64_t      PageNumber;
+  uint32_t      RefCount;                 ///< One reference for the live table, one for the snapshot
+  bool          Dirty;
+  UT_FAKE_PAGE  *NextDirty;               ///< Next page on the space's dirty list
+  UT_FAKE_PAGE  *Original;                ///< Snapshot page this copy replaced (not owned), or NULL
+};
+
+typedef struct {
+  void    *Entries[UT_FAKE_LEVEL_ENTRIES];
+} UT_FAKE_NODE;
+
+typedef struct _UT_FAKE_BACKING UT_FAKE_BACKING;
+
+struct _UT_FAKE_BACKING {
+  uint64_t        Base;
+  uint64_t        Length;
+  const uint8_t   *Data;
+  const void      *Owner;
+  UT_FAKE_BACKING *Next;
+};
+
+typedef struct _UT_FAKE_HANDLER UT_FAKE_HANDLER;
+
+struct _UT_FAKE_HANDLER {
+  uint64_t          Base;
+  uint64_t          Length;
+  UT_FAKE_REGISTER  Register;
+  UT_FAKE_HANDLER   *Next;
+};
+
+typedef struct {
+  uint8_t           Bitmap[UT_FAKE_PAGE_SIZE / 8];                ///< One bit per byte covered by a register
+  uint32_t          HandlerCount;
+  uint32_t          HandlerCapacity;
+  UT_FAKE_HANDLER   **Handlers;                                   ///< Register ranges overlapping the page
+} UT_FAKE_HANDLER_PAGE;
+
+struct _UT_FAKE_SPACE {
+  char          Name[UT_FAKE_MAX_NAME_LENGTH + 1];
+  uint32_t      Id;
+  uint8_t       DefaultValue;
+  size_t        PageCount;
+  uint32_t      Generation;               ///< Bumped whenever table entries change; invalidates the page caches
+  UT_FAKE_PAGE  *DirtyList;
+  UT_FAKE_NODE  *Root;
+  UT_FAKE_BACKING *Backing;               ///< Read-only memory under the pages, NULL for most spaces
+  UT_FAKE_PAGE  **SnapshotPages;
+  size_t        SnapshotPageCount;
+  uint8_t       SnapshotDefaultValue;
+  UT_FAKE_NODE  *HandlerRoot;             ///< Table of UT_FAKE_HANDLER_PAGE, NULL if the space has no registers
+  UT_FAKE_HANDLER *Handlers;
+  uint32_t      HandlerGeneration;        ///< Bumped whenever registers are added or removed; invalidates the register caches
+};
+
+typedef struct {
+  uint64_t      PageNumber;
+  uint32_t      Generation;
+  UT_FAKE_PAGE  *Page;
+} UT_FAKE_PAGE_CACHE;
+
+typedef struct {
+  uint64_t              PageNumber;
+  uint32_t              Generation;
+  bool                  Valid;
+  UT_FAKE_HANDLER_PAGE  *HandlerPage;     ///< NULL for a page without registers
+} UT_FAKE_HANDLER_CACHE;
+
+static UT_FAKE_SPACE                  *mFakeSpaces[UT_FAKE_MAX_SPACES];
+static uint32_t                       mFakeSpaceCount = 0;
+static const UT_FAKE_STATE_PROVIDER   *mFakeProviders[UT_FAKE_MAX_PROVIDERS];
+static uint32_t                       mFakeProviderCount = 0;
+static bool                           mFakeSnapshotTaken = false;
+static UT_FAKE_READ_HOOK              mFakeReadHook = NULL;
+
+static UT_FAKE_THREAD_LOCAL UT_FAKE_PAGE_CACHE mFakePageCache[UT_FAKE_MAX_SPACES];
+static UT_FAKE_THREAD_LOCAL UT_FAKE_HANDLER_CACHE mFakeHandlerCache[UT_FAKE_MAX_SPACES];
+
+/**
+ * UtFakeFill
+ * @brief Fills Buffer with the contents of never-written addresses.
+ *
+ * @details That is the default value, overlaid with the space's backings
+ *          in the order they were added.
+ *
+ * @param Space    Address space
+ * @param Address  64-bit start address
+ * @param Buffer   Buffer receiving the data
+ * @param Length   Number of bytes (must not wrap around the address space)
+ */
+static
+void
+UtFakeFill (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint8_t       *Buffer,
+  size_t        Length
+  )
+{
+  UT_FAKE_BACKING *Backing;
+  uint64_t        First;
+  uint64_t        Last;
+
+  memset (Buffer, Space->DefaultValue, Length);
+  for (Backing = Space->Backing; Backing != NULL; Backing = Backing->Next) {
+    First = (Address > Backing->Base) ? Address : Backing->Base;
+    Last  = Address + (Length - 1);
+    if (Last > Backing->Base + (Backing->Length - 1)) {
+      Last = Backing->Base + (Backing->Length - 1);
+    }
+    if (First <= Last) {
+      memcpy (&Buffer[First - Address], &Backing->Data[First - Backing->Base], (size_t)(Last - First + 1));
+    }
+  }
+}
+
+/**
+ * UtFakeLookupSlot
+ * @brief Walks a radix table to the leaf entry of PageNumber.
+ *
+ * @param Root        Root node of the table
+ * @param PageNumber  Address >> UT_FAKE_PAGE_SHIFT
+ * @param Allocate    Allocate missing table nodes
+ *
+ * @return Pointer to the leaf entry, or NULL if a table node is missing (or cannot be allocated).
+ */
+static
+void **
+UtFakeLookupSlot (
+  UT_FAKE_NODE  *Root,
+  uint64_t      PageNumber,
+  bool          Allocate
+  )
+{
+  UT_FAKE_NODE  *Node;
+  UT_FAKE_NODE  *Next;
+  size_t        Index;
+  uint32_t      Level;
+
+  Node = Root;
+  for (Level = UT_FAKE_LEVEL_COUNT - 1; Level > 0; Level--) {
+    Index = (size_t)((PageNumber >> (Level * UT_FAKE_LEVEL_BITS)) & UT_FAKE_LEVEL_MASK);
+    Next  = (UT_FAKE_NODE*) Node->Entries[Index];
+    if (Next == NULL) {
+      if (!Allocate) {
+        return NULL;
+      }
+      Next = (UT_FAKE_NODE*) calloc (1, sizeof (UT_FAKE_NODE));
+      if (Next == NULL) {
+        assert (false);
+        return NULL;
+      }
+      Node->Entries[Index] = Next;
+    }
+    Node = Next;
+  }
+  return &Node->Entries[PageNumber & UT_FAKE_LEVEL_MASK];
+}
+
+/**
+ * UtFakeLookupPage
+ * @brief Returns the live page holding PageNumber.
+ *
+ * @param Space       Address space
+ * @param PageNumber  Address >> UT_FAKE_PAGE_SHIFT
+ * @param Allocate    Allocate missing table nodes and the page itself
+ *
+ * @return Pointer to the page, or NULL if it does not exist (or cannot be allocated).
+ */
+static
+UT_FAKE_PAGE *
+UtFakeLookupPage (
+  UT_FAKE_SPACE *Space,
+  uint64_t      PageNumber,
+  bool          Allocate
+  )
+{
+  UT_FAKE_PAGE_CACHE  *Cache;
+  UT_FAKE_PAGE        **Slot;
+  UT_FAKE_PAGE        *Page;
+
+  Cache = &mFakePageCache[Space->Id];
+  if ((Cache->Page != NULL) && (Cache->PageNumber == PageNumber) && (Cache->Generation == Space->Generation)) {
+    return Cache->Page;
+  }
+
+  Slot = (UT_FAKE_PAGE**) UtFakeLookupSlot (Space->Root, PageNumber, Allocate);
+  if (Slot == NULL) {
+    return NULL;
+  }
+  Page = *Slot;
+  if (Page == NULL) {
+    if (!Allocate) {
+      return NULL;
+    }
+    Page = (UT_FAKE_PAGE*) malloc (sizeof (UT_FAKE_PAGE));
+    if (Page == NULL) {
+      assert (false);
+      return NULL;
+    }
+    UtFakeFill (Space, PageNumber << UT_FAKE_PAGE_SHIFT, Page->Data, sizeof (Page->Data));
+    Page->PageNumber = PageNumber;
+    Page->RefCount   = 1;
+    Page->Dirty      = false;
+    Page->NextDirty  = NULL;
+    Page->Original   = NULL;
+    *Slot = Page;
+    Space->PageCount++;
+  }
+
+  Cache->PageNumber = PageNumber;
+  Cache->Generation = Space->Generation;
+  Cache->Page       = Page;
+  return Page;
+}
+
+/**
+ * UtFakePutPage
+ * @brief Drops one reference to a page and frees it once nothing holds it.
+ *
+ * @param Page  Page to release
+ */
+static
+void
+UtFakePutPage (
+  UT_FAKE_PAGE  *Page
+  )
+{
+  assert (Page->RefCount > 0);
+  if (--Page->RefCount == 0) {
+    free (Page);
+  }
+}
+
+/**
+ * UtFakeGetWritablePage
+ * @brief Prepares a live page for a write.
+ *
+ * @details A page still shared with the snapshot is copied first. The page
+ *          written is linked on the dirty list on its first write since the
+ *          last reset, restore or snapshot.
+ *
+ * @param Space  Address space
+ * @param Page   Live page about to be written
+ *
+ * @return Page to write to (Page itself or its private copy), NULL on allocation failure.
+ */
+static
+UT_FAKE_PAGE *
+UtFakeGetWritablePage (
+  UT_FAKE_SPACE *Space,
+  UT_FAKE_PAGE  *Page
+  )
+{
+  UT_FAKE_PAGE  *Copy;
+
+  if (Page->Dirty) {
+    return Page;
+  }
+
+  if (Page->RefCount > 1) {
+    Copy = (UT_FAKE_PAGE*) malloc (sizeof (UT_FAKE_PAGE));
+    if (Copy == NULL) {
+      assert (false);
+      return NULL;
+    }
+    memcpy (Copy->Data, Page->Data, sizeof (Copy->Data));
+    Copy->PageNumber = Page->PageNumber;
+    Copy->RefCount   = 1;
+    Copy->Original   = Page;
+    *UtFakeLookupSlot (Space->Root, Page->PageNumber, false) = Copy;
+    UtFakePutPage (Page);
+    Space->Generation++;
+    Page = Copy;
+  }
+
+  Page->Dirty      = true;
+  Page->NextDirty  = Space->DirtyList;
+  Space->DirtyList = Page;
+  return Page;
+}
+
+/**
+ * UtFakeSpaceRollBack
+ * @brief Undoes every write made since the last snapshot, or since the last reset if there is none.
+ *
+ * @param Space  Address space
+ */
+static
+void
+UtFakeSpaceRollBack (
+  UT_FAKE_SPACE *Space
+  )
+{
+  UT_FAKE_PAGE  *Page;
+  UT_FAKE_PAGE  *Next;
+  UT_FAKE_PAGE  **Slot;
+
+  for (Page = Space->DirtyList; Page != NULL; Page = Next) {
+    Next = Page->NextDirty;
+    Slot = (UT_FAKE_PAGE**) UtFakeLookupSlot (Space->Root, Page->PageNumber, false);
+    assert ((Slot != NULL) && (*Slot == Page));
+    if (Page->Original != NULL) {
+      Page->Original->RefCount++;
+      *Slot = Page->Original;
+    } else {
+      *Slot = NULL;
+      Space->PageCount--;
+    }
+    UtFakePutPage (Page);
+  }
+  Space->DirtyList = NULL;
+  Space->Generation++;
+}
+
+/**
+ * UtFakeSpaceCollectPages
+ * @brief Calls Callback for every live page below Node.
+ *
+ * @param Node      Table node
+ * @param Level     Level of Node (0 for leaf nodes)
+ * @param Callback  Function called for each page
+ * @param Space     Address space passed to Callback
+ */
+static
+void
+UtFakeSpaceCollectPages (
+  UT_FAKE_NODE  *Node,
+  uint32_t      Level,
+  void          (*Callback) (UT_FAKE_SPACE *Space, UT_FAKE_PAGE *Page),
+  UT_FAKE_SPACE *Space
+  )
+{
+  size_t Index;
+
+  for (Index = 0; Index < UT_FAKE_LEVEL_ENTRIES; Index++) {
+    if (Node->Entries[Index] == NULL) {
+      continue;
+    }
+    if (Level == 0) {
+      Callback (Space, (UT_FAKE_PAGE*) Node->Entries[Index]);
+    } else {
+      UtFakeSpaceCollectPages ((UT_FAKE_NODE*) Node->Entries[Index], Level - 1, Callback, Space);
+    }
+  }
+}
+
+/**
+ * UtFakeSnapshotPage
+ * @brief Shares a live page with the snapshot being taken.
+ */
+static
+void
+UtFakeSnapshotPage (
+  UT_FAKE_SPACE *Space,
+  UT_FAKE_PAGE  *Page
+  )
+{
+  Page->RefCount++;
+  Page->Dirty     = false;
+  Page->NextDirty = NULL;
+  Page->Original  = NULL;
+  Space->SnapshotPages[Space->SnapshotPageCount++] = Page;
+}
+
+/**
+ * UtFakeUnsharePage
+ * @brief Detaches a live page from the snapshot being dropped.
+ */
+static
+void
+UtFakeUnsharePage (
+  UT_FAKE_SPACE *Space,
+  UT_FAKE_PAGE  *Page
+  )
+{
+  //
+  // Without a snapshot every live page must be on the dirty list, so that
+  // a reset returns it to the default value.
+  //
+  Page->Original = NULL;
+  if (!Page->Dirty) {
+    Page->Dirty      = true;
+    Page->NextDirty  = Space->DirtyList;
+    Space->DirtyList = Page;
+  }
+}
+
+/**
+ * UtFakeSpaceDropSnapshot
+ * @brief Releases the snapshot references of a space; live contents are kept.
+ *
+ * @param Space  Address space
+ */
+static
+void
+UtFakeSpaceDropSnapshot (
+  UT_FAKE_SPACE *Space
+  )
+{
+  size_t Index;
+
+  if (Space->SnapshotPages == NULL) {
+    return;
+  }
+  UtFakeSpaceCollectPages (Space->Root, UT_FAKE_LEVEL_COUNT - 1, UtFakeUnsharePage, Space);
+  for (Index = 0; Index < Space->SnapshotPageCount; Index++) {
+    UtFakePutPage (Space->SnapshotPages[Index]);
+  }
+  free (Space->SnapshotPages);
+  Space->SnapshotPages     = NULL;
+  Space->SnapshotPageCount = 0;
+}
+
+/**
+ * UtFakeSpaceTakeSnapshot
+ * @brief Makes the current contents of a space its snapshot.
+ *
+ * @param Space  Address space
+ *
+ * @retval true   Snapshot taken
+ * @retval false  Out of memory; the previous snapshot (if any) was released
+ */
+static
+bool
+UtFakeSpaceTakeSnapshot (
+  UT_FAKE_SPACE *Space
+  )
+{
+  UT_FAKE_PAGE  **OldPages;
+  size_t        OldPageCount;
+  size_t        Index;
+
+  OldPages                 = Space->SnapshotPages;
+  OldPageCount             = Space->SnapshotPageCount;
+  Space->SnapshotPageCount = 0;
+  Space->SnapshotPages     = (UT_FAKE_PAGE**) malloc ((Space->PageCount + 1) * sizeof (UT_FAKE_PAGE*));
+  if (Space->SnapshotPages == NULL) {
+    assert (false);
+    Space->SnapshotPages     = OldPages;
+    Space->SnapshotPageCount = OldPageCount;
+    UtFakeSpaceDropSnapshot (Space);
+    return false;
+  }
+
+  UtFakeSpaceCollectPages (Space->Root, UT_FAKE_LEVEL_COUNT - 1, UtFakeSnapshotPage, Space);
+  Space->DirtyList            = NULL;
+  Space->SnapshotDefaultValue = Space->DefaultValue;
+
+  //
+  // Pages that were replaced since the previous snapshot are only held by it.
+  //
+  for (Index = 0; Index < OldPageCount; Index++) {
+    UtFakePutPage (OldPages[Index]);
+  }
+  free (OldPages);
+  return true;
+}
+
+/**
+ * UtFakeSpaceReset
+ * @brief Returns every address of a space to the default value.
+ *
+ * @details Only the pages written since the previous reset are visited.
+ *          The table nodes are kept for the next iteration. A snapshot of
+ *          the space, if any, is discarded, and so are its registers.
+ *
+ * @param Space  Address space
+ */
+void
+UtFakeSpaceReset (
+  UT_FAKE_SPACE *Space
+  )
+{
+  UtFakeSpaceDropSnapshot (Space);
+  UtFakeSpaceRollBack (Space);
+  UtFakeSpaceRemoveRegisters (Space);
+}
+
+/**
+ * UtFakeRegisterStateProvider
+ * @brief Adds fake state that is not kept in an address space to the snapshots.
+ *
+ * @details Snapshot, Restore and Discard of every provider are called by
+ *          UtFakeSnapshot, UtFakeRestore and UtFakeSnapshotDiscard; Reset is
+ *          called by UtFakeResetAll when there is no snapshot to restore.
+ *          Registering the same provider twice has no effect.
+ *
+ * @param Provider  Provider (must stay valid for the life of the process)
+ *
+ * @retval true   Provider registered
+ * @retval false  Too many providers
+ */
+bool
+UtFakeRegisterStateProvider (
+  const UT_FAKE_STATE_PROVIDER  *Provider
+  )
+{
+  uint32_t Index;
+
+  for (Index = 0; Index < mFakeProviderCount; Index++) {
+    if (mFakeProviders[Index] == Provider) {
+      return true;
+    }
+  }
+  if (mFakeProviderCount >= UT_FAKE_MAX_PROVIDERS) {
+    assert (false);
+    return false;
+  }
+  mFakeProviders[mFakeProviderCount++] = Provider;
+  if (mFakeSnapshotTaken && (Provider->Snapshot != NULL)) {
+    Provider->Snapshot ();
+  }
+  return true;
+}
+
+/**
+ * UtFakeSnapshot
+ * @brief Captures the state of every fake (address spaces and state providers).
+ *
+ * @details Pages are shared with the snapshot rather than copied, so the
+ *          cost is one reference per live page. Taking a new snapshot
+ *          replaces the previous one. Typical use: run the shared Arrange
+ *          phase once, call UtFakeSnapshot, then call UtFakeRestore before
+ *          each Act step.
+ *
+ * @retval true   Snapshot taken
+ * @retval false  Out of memory
+ */
+bool
+UtFakeSnapshot (
+  void
+  )
+{
+  uint32_t  Index;
+  bool      Result;
+
+  Result = true;
+  for (Index = 0; Index < mFakeSpaceCount; Index++) {
+    Result &= UtFakeSpaceTakeSnapshot (mFakeSpaces[Index]);
+  }
+  for (Index = 0; Index < mFakeProviderCount; Index++) {
+    if (mFakeProviders[Index]->Snapshot != NULL) {
+      mFakeProviders[Index]->Snapshot ();
+    }
+  }
+  mFakeSnapshotTaken = true;
+  return Result;
+}
+
+/**
+ * UtFakeRestore
+ * @brief Returns every fake to the state captured by the last UtFakeSnapshot.
+ *
+ * @details Only the pages written since the snapshot (or the last restore)
+ *          are visited. The snapshot is kept, so it can be restored again.
+ *
+ * @retval true   State restored
+ * @retval false  No snapshot was taken
+ */
+bool
+UtFakeRestore (
+  void
+  )
+{
+  uint32_t Index;
+
+  if (!mFakeSnapshotTaken) {
+    return false;
+  }
+  for (Index = 0; Index < mFakeSpaceCount; Index++) {
+    UtFakeSpaceRollBack (mFakeSpaces[Index]);
+    mFakeSpaces[Index]->DefaultValue = mFakeSpaces[Index]->SnapshotDefaultValue;
+  }
+  for (Index = 0; Index < mFakeProviderCount; Index++) {
+    if (mFakeProviders[Index]->Restore != NULL) {
+      mFakeProviders[Index]->Restore ();
+    }
+  }
+  return true;
+}
+
+/**
+ * UtFakeSnapshotDiscard
+ * @brief Releases the snapshot; the current state of the fakes is kept.
+ */
+void
+UtFakeSnapshotDiscard (
+  void
+  )
+{
+  uint32_t Index;
+
+  for (Index = 0; Index < mFakeSpaceCount; Index++) {
+    UtFakeSpaceDropSnapshot (mFakeSpaces[Index]);
+  }
+  for (Index = 0; Index < mFakeProviderCount; Index++) {
+    if (mFakeProviders[Index]->Discard != NULL) {
+      mFakeProviders[Index]->Discard ();
+    }
+  }
+  mFakeSnapshotTaken = false;
+}
+
+/**
+ * UtFakeResetAll
+ * @brief Resets every fake between iterations.
+ *
+ * @details Registered with UtBaseLib when the first space is created, so the
+ *          runner calls it after each iteration's clean up. If a snapshot was
+ *          taken the fakes return to it, so that iterations sharing an
+ *          Arrange phase keep it; otherwise every address space returns to
+ *          the default value and every state provider is reset.
+ */
+void
+UtFakeResetAll (
+  void
+  )
+{
+  uint32_t Index;
+
+  if (UtFakeRestore ()) {
+    return;
+  }
+  for (Index = 0; Index < mFakeSpaceCount; Index++) {
+    UtFakeSpaceReset (mFakeSpaces[Index]);
+  }
+  for (Index = 0; Index < mFakeProviderCount; Index++) {
+    if (mFakeProviders[Index]->Reset != NULL) {
+      mFakeProviders[Index]->Reset ();
+    }
+  }
+}
+
+/**
+ * UtFakeSpaceGet
+ * @brief Returns the address space called Name, creating it on first use.
+ *
+ * @details New spaces read as 0x00 until UtFakeSpaceSetDefaultValue is called.
+ *
+ * @param Name  Space name (e.g. UT_FAKE_SPACE_MMIO)
+ *
+ * @return Pointer to the space, or NULL if it cannot be created.
+ */
+UT_FAKE_SPACE *
+UtFakeSpaceGet (
+  const char  *Name
+  )
+{
+  UT_FAKE_SPACE *Space;
+  uint32_t      Index;
+
+  for (Index = 0; Index < mFakeSpaceCount; Index++) {
+    if (strncmp (mFakeSpaces[Index]->Name, Name, UT_FAKE_MAX_NAME_LENGTH) == 0) {
+      return mFakeSpaces[Index];
+    }
+  }
+
+  if (mFakeSpaceCount >= UT_FAKE_MAX_SPACES) {
+    assert (false);
+    return NULL;
+  }
+
+  Space = (UT_FAKE_SPACE*) calloc (1, sizeof (UT_FAKE_SPACE));
+  if (Space == NULL) {
+    assert (false);
+    return NULL;
+  }
+  Space->Root = (UT_FAKE_NODE*) calloc (1, sizeof (UT_FAKE_NODE));
+  if (Space->Root == NULL) {
+    assert (false);
+    free (Space);
+    return NULL;
+  }
+  strncpy (Space->Name, Name, UT_FAKE_MAX_NAME_LENGTH);
+  Space->Id = mFakeSpaceCount;
+  if (mFakeSnapshotTaken) {
+    //
+    // A space created after the snapshot was empty when it was taken.
+    //
+    Space->SnapshotPages = (UT_FAKE_PAGE**) malloc (sizeof (UT_FAKE_PAGE*));
+    if (Space->SnapshotPages == NULL) {
+      assert (false);
+      free (Space->Root);
+      free (Space);
+      return NULL;
+    }
+  }
+  mFakeSpaces[mFakeSpaceCount++] = Space;
+  return Space;
+}
+
+/**
+ * UtFakeMemLibConstructor
+ * @brief Registers the reset and register image handlers with UtBaseLib.
+ *
+ * @details Runs when the test binary is loaded, so the "FakeImage" key is
+ *          applied from the first iteration on, before any space is used.
+ */
+AMD_UNIT_TEST_CONSTRUCTOR (UtFakeMemLibConstructor)
+{
+  UtRegisterResetHandler (UtFakeResetAll);
+  UtRegisterSetupHandler (UtFakeImageSetup);
+}
+
+/**
+ * UtFakeSpaceAddBacking
+ * @brief Backs a range of a space with read-only memory.
+ *
+ * @details Where backings overlap, the one added last is read.
+ *
+ * @param Space    Address space
+ * @param Base     First address of the range
+ * @param Data     Memory holding the contents of the range (must stay valid until removed)
+ * @param Length   Length of the range in bytes
+ * @param Owner    Tag used to remove the backing again
+ *
+ * @retval true   Backing added
+ * @retval false  Out of memory
+ */
+bool
+UtFakeSpaceAddBacking (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Base,
+  const uint8_t *Data,
+  uint64_t      Length,
+  const void    *Owner
+  )
+{
+  UT_FAKE_BACKING *Backing;
+  UT_FAKE_BACKING **Link;
+
+  if (Length == 0) {
+    return true;
+  }
+  Backing = (UT_FAKE_BACKING*) malloc (sizeof (UT_FAKE_BACKING));
+  if (Backing == NULL) {
+    assert (false);
+    return false;
+  }
+  Backing->Base   = Base;
+  Backing->Length = Length;
+  Backing->Data   = Data;
+  Backing->Owner  = Owner;
+  Backing->Next   = NULL;
+
+  //
+  // UtFakeFill overlays the backings in list order, so the last one added
+  // goes to the tail.
+  //
+  Link = &Space->Backing;
+  while (*Link != NULL) {
+    Link = &(*Link)->Next;
+  }
+  *Link = Backing;
+  return true;
+}
+
+/**
+ * UtFakeRemoveBacking
+ * @brief Removes every backing tagged with Owner from all spaces.
+ *
+ * @details Pages already written keep their contents.
+ *
+ * @param Owner  Tag passed to UtFakeSpaceAddBacking
+ */
+void
+UtFakeRemoveBacking (
+  const void    *Owner
+  )
+{
+  UT_FAKE_BACKING **Link;
+  UT_FAKE_BACKING *Backing;
+  uint32_t        Index;
+
+  for (Index = 0; Index < mFakeSpaceCount; Index++) {
+    Link = &mFakeSpaces[Index]->Backing;
+    while (*Link != NULL) {
+      Backing = *Link;
+      if (Backing->Owner == Owner) {
+        *Link = Backing->Next;
+        free (Backing);
+      } else {
+        Link = &Backing->Next;
+      }
+    }
+  }
+}
+
+/**
+ * UtFakeSpaceSetDefaultValue
+ * @brief Sets the byte value returned by reads from never-written addresses.
+ *
+ * @details Pages that already exist keep their contents.
+ *
+ * @param Space  Address space
+ * @param Value  Default byte value
+ */
+void
+UtFakeSpaceSetDefaultValue (
+  UT_FAKE_SPACE *Space,
+  uint8_t       Value
+  )
+{
+  Space->DefaultValue = Value;
+}
+
+/**
+ * UtFakeSetReadHook
+ * @brief Installs a function called before every read of any space.
+ *
+ * @details Used by UtTimerFakeLib to advance its clock on register polls.
+ *          Reads made by the engine itself on behalf of register models do
+ *          not call the hook.
+ *
+ * @param Hook  Hook function, NULL to remove it
+ */
+void
+UtFakeSetReadHook (
+  UT_FAKE_READ_HOOK Hook
+  )
+{
+  mFakeReadHook = Hook;
+}
+
+/**
+ * UtFakeSpaceGetPageCount
+ * @brief Returns the number of live 4 KB pages in a space.
+ *
+ * @param Space  Address space
+ */
+size_t
+UtFakeSpaceGetPageCount (
+  UT_FAKE_SPACE *Space
+  )
+{
+  return Space->PageCount;
+}
+
+/**
+ * UtFakeFreeHandlerPage
+ * @brief Frees the register bitmap of a page.
+ *
+ * @param HandlerPage  Register bitmap
+ */
+static
+void
+UtFakeFreeHandlerPage (
+  UT_FAKE_HANDLER_PAGE  *HandlerPage
+  )
+{
+  free (HandlerPage->Handlers);
+  free (HandlerPage);
+}
+
+/**
+ * UtFakeFreeTable
+ * @brief Frees a register table node, everything below it and the register bitmaps.
+ *
+ * @param Node   Table node
+ * @param Level  Level of Node (0 for leaf nodes)
+ */
+static
+void
+UtFakeFreeTable (
+  UT_FAKE_NODE  *Node,
+  uint32_t      Level
+  )
+{
+  size_t Index;
+
+  for (Index = 0; Index < UT_FAKE_LEVEL_ENTRIES; Index++) {
+    if (Node->Entries[Index] == NULL) {
+      continue;
+    }
+    if (Level == 0) {
+      UtFakeFreeHandlerPage ((UT_FAKE_HANDLER_PAGE*) Node->Entries[Index]);
+    } else {
+      UtFakeFreeTable ((UT_FAKE_NODE*) Node->Entries[Index], Level - 1);
+    }
+  }
+  free (Node);
+}
+
+/**
+ * UtFakeLookupHandlerPage
+ * @brief Returns the register bitmap of a page.
+ *
+ * @details The answer for the last page looked up, with or without
+ *          registers, is cached per thread.
+ *
+ * @param Space       Address space
+ * @param PageNumber  Address >> UT_FAKE_PAGE_SHIFT
+ *
+ * @return Pointer to the bitmap, or NULL if no register overlaps the page.
+ */
+static
+UT_FAKE_HANDLER_PAGE *
+UtFakeLookupHandlerPage (
+  UT_FAKE_SPACE *Space,
+  uint64_t      PageNumber
+  )
+{
+  UT_FAKE_HANDLER_CACHE *Cache;
+  void                  **Slot;
+
+  Cache = &mFakeHandlerCache[Space->Id];
+  if (Cache->Valid && (Cache->PageNumber == PageNumber) && (Cache->Generation == Space->HandlerGeneration)) {
+    return Cache->HandlerPage;
+  }
+
+  Slot = UtFakeLookupSlot (Space->HandlerRoot, PageNumber, false);
+  Cache->PageNumber  = PageNumber;
+  Cache->Generation  = Space->HandlerGeneration;
+  Cache->Valid       = true;
+  Cache->HandlerPage = (Slot == NULL) ? NULL : (UT_FAKE_HANDLER_PAGE*) *Slot;
+  return Cache->HandlerPage;
+}
+
+/**
+ * UtFakeFindHandler
+ * @brief Returns the register range covering Address.
+ *
+ * @param HandlerPage  Register bitmap of the page holding Address
+ * @param Address      Address whose bitmap bit is set
+ */
+static
+UT_FAKE_HANDLER *
+UtFakeFindHandler (
+  UT_FAKE_HANDLER_PAGE  *HandlerPage,
+  uint64_t              Address
+  )
+{
+  UT_FAKE_HANDLER *Handler;
+  uint32_t        Index;
+
+  for (Index = 0; Index < HandlerPage->HandlerCount; Index++) {
+    Handler = HandlerPage->Handlers[Index];
+    if ((Address >= Handler->Base) && (Address - Handler->Base < Handler->Length)) {
+      return Handler;
+    }
+  }
+  assert (false);
+  return NULL;
+}
+
+/**
+ * UtFakeIsModelled
+ * @brief Checks whether a byte is covered by a register.
+ */
+static
+bool
+UtFakeIsModelled (
+  const UT_FAKE_HANDLER_PAGE  *HandlerPage,
+  size_t                      Offset
+  )
+{
+  return (HandlerPage->Bitmap[Offset >> 3] & (1u << (Offset & 7))) != 0;
+}
+
+/**
+ * UtFakeReadChunk
+ * @brief Reads stored bytes that do not cross a page boundary.
+ */
+static
+void
+UtFakeReadChunk (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint8_t       *Destination,
+  size_t        Chunk
+  )
+{
+  UT_FAKE_PAGE  *Page;
+
+  Page = UtFakeLookupPage (Space, Address >> UT_FAKE_PAGE_SHIFT, false);
+  if (Page == NULL) {
+    UtFakeFill (Space, Address, Destination, Chunk);
+  } else {
+    memcpy (Destination, &Page->Data[Address & UT_FAKE_PAGE_MASK], Chunk);
+  }
+}
+
+/**
+ * UtFakeWriteChunk
+ * @brief Stores bytes that do not cross a page boundary.
+ */
+static
+void
+UtFakeWriteChunk (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  const uint8_t *Source,
+  size_t        Chunk
+  )
+{
+  UT_FAKE_PAGE  *Page;
+
+  Page = UtFakeLookupPage (Space, Address >> UT_FAKE_PAGE_SHIFT, true);
+  if (Page != NULL) {
+    Page = UtFakeGetWritablePage (Space, Page);
+  }
+  if (Page != NULL) {
+    memcpy (&Page->Data[Address & UT_FAKE_PAGE_MASK], Source, Chunk);
+  }
+}
+
+/**
+ * UtFakeReadModelled
+ * @brief Reads bytes of a page that has registers, calling their OnRead handlers.
+ *
+ * @details Each register touched by the access is read as a whole and its
+ *          OnRead handler called once, even if only some of its bytes are
+ *          read.
+ */
+static
+void
+UtFakeReadModelled (
+  UT_FAKE_SPACE         *Space,
+  UT_FAKE_HANDLER_PAGE  *HandlerPage,
+  uint64_t              Address,
+  uint8_t               *Destination,
+  size_t                Chunk
+  )
+{
+  UT_FAKE_HANDLER *Handler;
+  uint64_t        Register;
+  uint64_t        Value;
+  size_t          Index;
+  size_t          Byte;
+  uint8_t         Width;
+
+  UtFakeReadChunk (Space, Address, Destination, Chunk);
+  Index = 0;
+  while (Index < Chunk) {
+    if (!UtFakeIsModelled (HandlerPage, (size_t)((Address + Index) & UT_FAKE_PAGE_MASK))) {
+      Index++;
+      continue;
+    }
+    Handler  = UtFakeFindHandler (HandlerPage, Address + Index);
+    Width    = Handler->Register.Width;
+    Register = (Address + Index) & ~(uint64_t)(Width - 1);
+    if (Handler->Register.OnRead != NULL) {
+      Value = 0;
+      UtFakeReadChunk (Space, Register, (uint8_t*) &Value, Width);
+      Handler->Register.OnRead (Space, Register, &Value, Handler->Register.Context);
+      for (Byte = (size_t)(Address + Index - Register); (Byte < Width) && (Index < Chunk); Byte++, Index++) {
+        Destination[Index] = (uint8_t)(Value >> (Byte * 8));
+      }
+    } else {
+      Index += (size_t)(Register + Width - (Address + Index));
+    }
+  }
+}
+
+/**
+ * UtFakeWriteModelled
+ * @brief Writes bytes of a page that has registers, applying their masks and OnWrite handlers.
+ *
+ * @details A partial write to a register is merged with its stored value
+ *          first; masks apply only to the bits written. OnWrite still sees
+ *          the self-clearing bits written as 1, they are cleared from the
+ *          value it returns.
+ */
+static
+void
+UtFakeWriteModelled (
+  UT_FAKE_SPACE         *Space,
+  UT_FAKE_HANDLER_PAGE  *HandlerPage,
+  uint64_t              Address,
+  const uint8_t         *Source,
+  size_t                Chunk
+  )
+{
+  UT_FAKE_HANDLER         *Handler;
+  const UT_FAKE_REGISTER  *Model;
+  uint64_t                Register;
+  uint64_t                OldValue;
+  uint64_t                NewValue;
+  uint64_t                Written;
+  uint64_t                WriteMask;
+  size_t                  Index;
+  size_t                  Run;
+  size_t                  Byte;
+
+  Index = 0;
+  while (Index < Chunk) {
+    if (!UtFakeIsModelled (HandlerPage, (size_t)((Address + Index) & UT_FAKE_PAGE_MASK))) {
+      Run = 1;
+      while ((Index + Run < Chunk) && !UtFakeIsModelled (HandlerPage, (size_t)((Address + Index + Run) & UT_FAKE_PAGE_MASK))) {
+        Run++;
+      }
+      UtFakeWriteChunk (Space, Address + Index, &Source[Index], Run);
+      Index += Run;
+      continue;
+    }
+
+    Handler  = UtFakeFindHandler (HandlerPage, Address + Index);
+    Model    = &Handler->Register;
+    Register = (Address + Index) & ~(uint64_t)(Model->Width - 1);
+    OldValue = 0;
+    UtFakeReadChunk (Space, Register, (uint8_t*) &OldValue, Model->Width);
+
+    Written   = 0;
+    WriteMask = 0;
+    for (Byte = (size_t)(Address + Index - Register); (Byte < Model->Width) && (Index < Chunk); Byte++, Index++) {
+      Written   |= (uint64_t)Source[Index] << (Byte * 8);
+      WriteMask |= (uint64_t)0xFF << (Byte * 8);
+    }
+
+    NewValue = (OldValue & ~WriteMask) | Written;
+    NewValue = (NewValue & ~Model->ReadOnlyMask) | (OldValue & Model->ReadOnlyMask);
+    NewValue = (NewValue & ~Model->Write1ClearMask) | (OldValue & Model->Write1ClearMask & ~Written);
+    if (Model->OnWrite != NULL) {
+      NewValue = Model->OnWrite (Space, Register, OldValue, NewValue, Model->Context);
+    }
+    NewValue &= ~(Model->SelfClearMask & WriteMask);
+    UtFakeWriteChunk (Space, Register, (const uint8_t*) &NewValue, Model->Width);
+  }
+}
+
+/**
+ * UtFakeReserveHandler
+ * @brief Makes room for one more register range in the register bitmap of a page.
+ *
+ * @param HandlerPage  Register bitmap
+ *
+ * @retval true   Room available
+ * @retval false  Out of memory
+ */
+static
+bool
+UtFakeReserveHandler (
+  UT_FAKE_HANDLER_PAGE  *HandlerPage
+  )
+{
+  UT_FAKE_HANDLER **Handlers;
+  uint32_t        Capacity;
+
+  if (HandlerPage->HandlerCount < HandlerPage->HandlerCapacity) {
+    return true;
+  }
+  Capacity = (HandlerPage->HandlerCapacity == 0) ? UT_FAKE_PAGE_REGISTERS : HandlerPage->HandlerCapacity * 2;
+  Handlers = (UT_FAKE_HANDLER**) realloc (HandlerPage->Handlers, Capacity * sizeof (UT_FAKE_HANDLER*));
+  if (Handlers == NULL) {
+    return false;
+  }
+  HandlerPage->Handlers        = Handlers;
+  HandlerPage->HandlerCapacity = Capacity;
+  return true;
+}
+
+/**
+ * UtFakeReleaseHandlerPages
+ * @brief Undoes the preparation of a failed UtFakeSpaceAddRegisters.
+ *
+ * @details Frees the register bitmaps of the pages from Base to Last that
+ *          have no register, and the register table if the space has no
+ *          register at all.
+ *
+ * @param Space  Address space
+ * @param Base   First address prepared
+ * @param Last   Last address prepared
+ */
+static
+void
+UtFakeReleaseHandlerPages (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Base,
+  uint64_t      Last
+  )
+{
+  UT_FAKE_HANDLER_PAGE  **Slot;
+  uint64_t              Address;
+
+  if (Space->Handlers == NULL) {
+    UtFakeSpaceRemoveRegisters (Space);
+    return;
+  }
+  for (Address = Base; ; Address = (Address | UT_FAKE_PAGE_MASK) + 1) {
+    Slot = (UT_FAKE_HANDLER_PAGE**) UtFakeLookupSlot (Space->HandlerRoot, Address >> UT_FAKE_PAGE_SHIFT, false);
+    if ((Slot != NULL) && (*Slot != NULL) && ((*Slot)->HandlerCount == 0)) {
+      UtFakeFreeHandlerPage (*Slot);
+      *Slot = NULL;
+    }
+    if ((Address | UT_FAKE_PAGE_MASK) >= Last) {
+      break;
+    }
+  }
+  Space->HandlerGeneration++;
+}
+
+/**
+ * UtFakeSpaceAddRegisters
+ * @brief Models the registers of a range as having side effects.
+ *
+ * @details The range is split into naturally aligned registers of
+ *          Register->Width bytes, each with the masks and handlers of
+ *          Register. Stored values start out as they are (default value,
+ *          image or earlier writes) and are reset and snapshotted like any
+ *          other memory. A restore keeps the registers; a reset removes them.
+ *
+ *          Handlers may access the space, including other registers, but
+ *          must not read or write the register they were called for. Use
+ *          UtFakeSpaceLoad and UtFakeSpaceStore to see its stored value and
+ *          to change bits that writes cannot.
+ *
+ *          On failure the registers of the space are left as they were.
+ *
+ * @param Space     Address space
+ * @param Base      First address of the range (aligned to Register->Width)
+ * @param Length    Length of the range in bytes (multiple of Register->Width)
+ * @param Register  Register model (copied)
+ *
+ * @retval true   Registers added
+ * @retval false  Invalid width or alignment, overlap with registers added earlier, or out of memory
+ */
+bool
+UtFakeSpaceAddRegisters (
+  UT_FAKE_SPACE           *Space,
+  uint64_t                Base,
+  uint64_t                Length,
+  const UT_FAKE_REGISTER  *Register
+  )
+{
+  UT_FAKE_HANDLER       *Handler;
+  UT_FAKE_HANDLER_PAGE  *HandlerPage;
+  UT_FAKE_HANDLER_PAGE  **Slot;
+  uint64_t              Address;
+  uint64_t              Last;
+  size_t                Offset;
+
+  if ((Register->Width != 1) && (Register->Width != 2) && (Register->Width != 4) && (Register->Width != 8)) {
+    return false;
+  }
+  if ((Length == 0) || (((Base | Length) & (Register->Width - 1)) != 0) || (Base + (Length - 1) < Base)) {
+    return false;
+  }
+  Last = Base + (Length - 1);
+
+  if (Space->HandlerRoot != NULL) {
+    for (Address = Base; ; Address++) {
+      HandlerPage = UtFakeLookupHandlerPage (Space, Address >> UT_FAKE_PAGE_SHIFT);
+      if (HandlerPage == NULL) {
+        Address |= UT_FAKE_PAGE_MASK;
+      } else if (UtFakeIsModelled (HandlerPage, (size_t)(Address & UT_FAKE_PAGE_MASK))) {
+        return false;
+      }
+      if (Address >= Last) {
+        break;
+      }
+    }
+  } else {
+    Space->HandlerRoot = (UT_FAKE_NODE*) calloc (1, sizeof (UT_FAKE_NODE));
+    if (Space->HandlerRoot == NULL) {
+      assert (false);
+      return false;
+    }
+  }
+
+  Handler = (UT_FAKE_HANDLER*) malloc (sizeof (UT_FAKE_HANDLER));
+  if (Handler == NULL) {
+    assert (false);
+    UtFakeReleaseHandlerPages (Space, Base, Base);
+    return false;
+  }
+  Handler->Base     = Base;
+  Handler->Length   = Length;
+  Handler->Register = *Register;
+
+  //
+  // Every page of the range gets its bitmap and room for the register
+  // first, so that a failure leaves the space as it was.
+  //
+  for (Address = Base; ; Address = (Address | UT_FAKE_PAGE_MASK) + 1) {
+    Slot = (UT_FAKE_HANDLER_PAGE**) UtFakeLookupSlot (Space->HandlerRoot, Address >> UT_FAKE_PAGE_SHIFT, true);
+    if ((Slot != NULL) && (*Slot == NULL)) {
+      *Slot = (UT_FAKE_HANDLER_PAGE*) calloc (1, sizeof (UT_FAKE_HANDLER_PAGE));
+    }
+    if ((Slot == NULL) || (*Slot == NULL) || !UtFakeReserveHandler (*Slot)) {
+      assert (false);
+      free (Handler);
+      UtFakeReleaseHandlerPages (Space, Base, Address);
+      return false;
+    }
+    if ((Address | UT_FAKE_PAGE_MASK) >= Last) {
+      break;
+    }
+  }
+
+  Handler->Next   = Space->Handlers;
+  Space->Handlers = Handler;
+  Space->HandlerGeneration++;
+  for (Address = Base; ; Address = (Address | UT_FAKE_PAGE_MASK) + 1) {
+    HandlerPage = *(UT_FAKE_HANDLER_PAGE**) UtFakeLookupSlot (Space->HandlerRoot, Address >> UT_FAKE_PAGE_SHIFT, false);
+    HandlerPage->Handlers[HandlerPage->HandlerCount++] = Handler;
+    for (Offset = (size_t)(Address & UT_FAKE_PAGE_MASK); ; Offset++) {
+      HandlerPage->Bitmap[Offset >> 3] |= (uint8_t)(1u << (Offset & 7));
+      if ((Offset == UT_FAKE_PAGE_MASK) || ((Address & ~(uint64_t)UT_FAKE_PAGE_MASK) + Offset == Last)) {
+        break;
+      }
+    }
+    if ((Address | UT_FAKE_PAGE_MASK) >= Last) {
+      break;
+    }
+  }
+  return true;
+}
+
+/**
+ * UtFakeSpaceRemoveRegisters
+ * @brief Removes every register model of a space; stored values are kept.
+ *
+ * @param Space  Address space
+ */
+void
+UtFakeSpaceRemoveRegisters (
+  UT_FAKE_SPACE *Space
+  )
+{
+  UT_FAKE_HANDLER *Handler;
+
+  if (Space->HandlerRoot == NULL) {
+    return;
+  }
+  UtFakeFreeTable (Space->HandlerRoot, UT_FAKE_LEVEL_COUNT - 1);
+  Space->HandlerRoot = NULL;
+  Space->HandlerGeneration++;
+  while (Space->Handlers != NULL) {
+    Handler         = Space->Handlers;
+    Space->Handlers = Handler->Next;
+    free (Handler);
+  }
+}
+
+/**
+ * UtFakeSpaceRead
+ * @brief Reads Length bytes starting at Address.
+ *
+ * @param Space    Address space
+ * @param Address  64-bit start address
+ * @param Buffer   Buffer receiving the data
+ * @param Length   Number of bytes to read
+ */
+void
+UtFakeSpaceRead (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  void          *Buffer,
+  size_t        Length
+  )
+{
+  UT_FAKE_HANDLER_PAGE  *HandlerPage;
+  uint8_t               *Destination;
+  size_t                Chunk;
+
+  if (mFakeReadHook != NULL) {
+    mFakeReadHook (Space, Address);
+  }
+  Destination = (uint8_t*) Buffer;
+  while (Length > 0) {
+    Chunk = UT_FAKE_PAGE_SIZE - (size_t)(Address & UT_FAKE_PAGE_MASK);
+    if (Chunk > Length) {
+      Chunk = Length;
+    }
+    HandlerPage = NULL;
+    if (Space->HandlerRoot != NULL) {
+      HandlerPage = UtFakeLookupHandlerPage (Space, Address >> UT_FAKE_PAGE_SHIFT);
+    }
+    if (HandlerPage == NULL) {
+      UtFakeReadChunk (Space, Address, Destination, Chunk);
+    } else {
+      UtFakeReadModelled (Space, HandlerPage, Address, Destination, Chunk);
+    }
+    Destination += Chunk;
+    Address     += Chunk;
+    Length      -= Chunk;
+  }
+}
+
+/**
+ * UtFakeSpaceWrite
+ * @brief Writes Length bytes starting at Address.
+ *
+ * @param Space    Address space
+ * @param Address  64-bit start address
+ * @param Buffer   Buffer holding the data
+ * @param Length   Number of bytes to write
+ */
+void
+UtFakeSpaceWrite (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  const void    *Buffer,
+  size_t        Length
+  )
+{
+  UT_FAKE_HANDLER_PAGE  *HandlerPage;
+  const uint8_t         *Source;
+  size_t                Chunk;
+
+  Source = (const uint8_t*) Buffer;
+  while (Length > 0) {
+    Chunk = UT_FAKE_PAGE_SIZE - (size_t)(Address & UT_FAKE_PAGE_MASK);
+    if (Chunk > Length) {
+      Chunk = Length;
+    }
+    HandlerPage = NULL;
+    if (Space->HandlerRoot != NULL) {
+      HandlerPage = UtFakeLookupHandlerPage (Space, Address >> UT_FAKE_PAGE_SHIFT);
+    }
+    if (HandlerPage == NULL) {
+      UtFakeWriteChunk (Space, Address, Source, Chunk);
+    } else {
+      UtFakeWriteModelled (Space, HandlerPage, Address, Source, Chunk);
+    }
+    Source  += Chunk;
+    Address += Chunk;
+    Length  -= Chunk;
+  }
+}
+
+/**
+ * UtFakeSpaceStore
+ * @brief Writes Length bytes starting at Address, bypassing register models.
+ *
+ * @details For register handlers and test setup that must change bits the
+ *          code under test cannot, e.g. to raise a read-only status bit.
+ *
+ * @param Space    Address space
+ * @param Address  64-bit start address
+ * @param Buffer   Buffer holding the data
+ * @param Length   Number of bytes to write
+ */
+void
+UtFakeSpaceStore (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  const void    *Buffer,
+  size_t        Length
+  )
+{
+  const uint8_t *Source;
+  size_t        Chunk;
+
+  Source = (const uint8_t*) Buffer;
+  while (Length > 0) {
+    Chunk = UT_FAKE_PAGE_SIZE - (size_t)(Address & UT_FAKE_PAGE_MASK);
+    if (Chunk > Length) {
+      Chunk = Length;
+    }
+    UtFakeWriteChunk (Space, Address, Source, Chunk);
+    Source  += Chunk;
+    Address += Chunk;
+    Length  -= Chunk;
+  }
+}
+
+/**
+ * UtFakeSpaceLoad
+ * @brief Reads Length bytes starting at Address, bypassing register models and the read hook.
+ *
+ * @details The counterpart of UtFakeSpaceStore, for register handlers and
+ *          test checks that must see the stored values without the side
+ *          effects of a read by the code under test, e.g. clearing bits on
+ *          read or advancing the fake clock.
+ *
+ * @param Space    Address space
+ * @param Address  64-bit start address
+ * @param Buffer   Buffer receiving the data
+ * @param Length   Number of bytes to read
+ */
+void
+UtFakeSpaceLoad (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  void          *Buffer,
+  size_t        Length
+  )
+{
+  uint8_t *Destination;
+  size_t  Chunk;
+
+  Destination = (uint8_t*) Buffer;
+  while (Length > 0) {
+    Chunk = UT_FAKE_PAGE_SIZE - (size_t)(Address & UT_FAKE_PAGE_MASK);
+    if (Chunk > Length) {
+      Chunk = Length;
+    }
+    UtFakeReadChunk (Space, Address, Destination, Chunk);
+    Destination += Chunk;
+    Address     += Chunk;
+    Length      -= Chunk;
+  }
+}
+
+uint8_t
+UtFakeSpaceRead8 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address
+  )
+{
+  uint8_t Value;
+
+  UtFakeSpaceRead (Space, Address, &Value, sizeof (Value));
+  return Value;
+}
+
+uint16_t
+UtFakeSpaceRead16 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address
+  )
+{
+  uint16_t Value;
+
+  UtFakeSpaceRead (Space, Address, &Value, sizeof (Value));
+  return Value;
+}
+
+uint32_t
+UtFakeSpaceRead32 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address
+  )
+{
+  uint32_t Value;
+
+  UtFakeSpaceRead (Space, Address, &Value, sizeof (Value));
+  return Value;
+}
+
+uint64_t
+UtFakeSpaceRead64 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address
+  )
+{
+  uint64_t Value;
+
+  UtFakeSpaceRead (Space, Address, &Value, sizeof (Value));
+  return Value;
+}
+
+void
+UtFakeSpaceWrite8 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint8_t       Value
+  )
+{
+  UtFakeSpaceWrite (Space, Address, &Value, sizeof (Value));
+}
+
+void
+UtFakeSpaceWrite16 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint16_t      Value
+  )
+{
+  UtFakeSpaceWrite (Space, Address, &Value, sizeof (Value));
+}
+
+void
+UtFakeSpaceWrite32 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint32_t      Value
+  )
+{
+  UtFakeSpaceWrite (Space, Address, &Value, sizeof (Value));
+}
+
+void
+UtFakeSpaceWrite64 (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint64_t      Value
+  )
+{
+  UtFakeSpaceWrite (Space, Address, &Value, sizeof (Value));
+}
@@ -0,0 +1,47 @@
+/* Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved. */
+// SPDX-License-Identifier: MIT
+/**
+ * @file  UtFakeMemLibInternal.h
+ * @brief Functions shared between the UtFakeMemLib source files
+ *
+ */
+
+#pragma once
+
+#include <UtBaseLib.h>
+#include <Library/UtFakeMemLib.h>
+
+bool
+UtFakeSpaceAddBacking (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Base,
+  const uint8_t *Data,
+  uint64_t      Length,
+  const void    *Owner
+  );
+
+void
+UtFakeRemoveBacking (
+  const void    *Owner
+  );
+
+void
+UtFakeImageSetup (
+  AMD_UNIT_TEST_FRAMEWORK *Ut
+  );
+
+//
+// Implemented in UtFakeImageMap.c, which includes no UEFI headers so that it
+// can include the OS headers.
+//
+const void *
+UtFakeMapFile (
+  const char  *Path,
+  uint64_t    *Size
+  );
+
+void
+UtFakeUnmapFile (
+  const void  *Base,
+  uint64_t    Size
+  );
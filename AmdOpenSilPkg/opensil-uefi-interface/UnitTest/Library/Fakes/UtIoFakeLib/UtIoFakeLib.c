@@ -4,6 +4,9 @@
  * @file  UtIoFakeLib.c
  * @brief IO Access Fake Library
  *
+ * @details IO accesses are served by the UT_FAKE_SPACE_IO address space of
+ *          UtFakeMemLib. A 16/32-bit access to the top of the port range
+ *          continues past 0xFFFF instead of overrunning a buffer.
  */
 
 #include <Uefi.h>
@@ -12,8 +15,21 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <Io.h>
+#include <Library/UtFakeMemLib.h>
 
-static uint8_t IO[IO_ADDRESS_MAX_MOCK_VAL-IO_ADDRESS_MIN_MOCK_VAL+1] = {0};
+static UT_FAKE_SPACE *mIoSpace = NULL;
+
+static
+UT_FAKE_SPACE *
+IoFakeSpace (
+  void
+  )
+{
+  if (mIoSpace == NULL) {
+    mIoSpace = UtFakeSpaceGet (UT_FAKE_SPACE_IO);
+  }
+  return mIoSpace;
+}
 
 void
 xUSLIoWrite8 (
@@ -21,7 +37,7 @@ xUSLIoWrite8 (
   uint8_t Value
   )
 {
-  IO[Port-IO_ADDRESS_MIN_MOCK_VAL] = Value;
+  UtFakeSpaceWrite8 (IoFakeSpace (), Port, Value);
 }
 
 void
@@ -30,7 +46,7 @@ xUSLIoWrite16 (
   uint16_t Value
   )
 {
-  *((uint16_t*)&IO[Port-IO_ADDRESS_MIN_MOCK_VAL]) = Value;
+  UtFakeSpaceWrite16 (IoFakeSpace (), Port, Value);
 }
 
 void
@@ -39,7 +55,7 @@ xUSLIoWrite32 (
   uint32_t Value
   )
 {
-  *((uint32_t*)&IO[Port-IO_ADDRESS_MIN_MOCK_VAL]) = Value;
+  UtFakeSpaceWrite32 (IoFakeSpace (), Port, Value);
 }
 
 uint8_t
@@ -47,7 +63,7 @@ xUSLIoRead8 (
   uint16_t Port
   )
 {
-  return IO[Port-IO_ADDRESS_MIN_MOCK_VAL];
+  return UtFakeSpaceRead8 (IoFakeSpace (), Port);
 }
 
 uint16_t
@@ -55,7 +71,7 @@ xUSLIoRead16 (
   uint16_t Port
   )
 {
-  return *((uint16_t*)&IO[Port-IO_ADDRESS_MIN_MOCK_VAL]);
+  return UtFakeSpaceRead16 (IoFakeSpace (), Port);
 }
 
 uint32_t
@@ -63,7 +79,7 @@ xUSLIoRead32 (
   uint16_t Port
   )
 {
-  return *((uint32_t*)&IO[Port-IO_ADDRESS_MIN_MOCK_VAL]);
+  return UtFakeSpaceRead32 (IoFakeSpace (), Port);
 }
 
 void
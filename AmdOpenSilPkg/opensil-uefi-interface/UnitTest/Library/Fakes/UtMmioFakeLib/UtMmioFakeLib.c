@@ -4,21 +4,37 @@
  * @file  UtMmioFakeLib.c
  * @brief MMIO Access Fake Library
  *
+ * @details MMIO accesses are served by the UT_FAKE_SPACE_MMIO address space of
+ *          UtFakeMemLib, so any address is valid, not only the
+ *          MMIO_ADDRESS_MIN_MOCK_VAL..MMIO_ADDRESS_MAX_MOCK_VAL window.
  */
 
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 #include <Mmio.h>
+#include <Library/UtFakeMemLib.h>
 
-static uint8_t MMIO[MMIO_ADDRESS_SIZE] = {0};
+static UT_FAKE_SPACE *mMmioSpace = NULL;
+
+static
+UT_FAKE_SPACE *
+MmioFakeSpace (
+  void
+  )
+{
+  if (mMmioSpace == NULL) {
+    mMmioSpace = UtFakeSpaceGet (UT_FAKE_SPACE_MMIO);
+  }
+  return mMmioSpace;
+}
 
 uint8_t
 xUSLMemRead8 (
   const volatile void *Addr
   )
 {
-  return MMIO[(size_t)Addr-MMIO_ADDRESS_MIN_MOCK_VAL];
+  return UtFakeSpaceRead8 (MmioFakeSpace (), (uintptr_t)Addr);
 }
 
 uint16_t
@@ -26,7 +42,7 @@ xUSLMemRead16 (
   const volatile void *Addr
   )
 {
-  return *((uint16_t*)&MMIO[(size_t)Addr-MMIO_ADDRESS_MIN_MOCK_VAL]);
+  return UtFakeSpaceRead16 (MmioFakeSpace (), (uintptr_t)Addr);
 }
 
 uint32_t
@@ -34,7 +50,15 @@ xUSLMemRead32 (
   const volatile void *Addr
   )
 {
-  return *((uint32_t*)&MMIO[(size_t)Addr-MMIO_ADDRESS_MIN_MOCK_VAL]);
+  return UtFakeSpaceRead32 (MmioFakeSpace (), (uintptr_t)Addr);
+}
+
+uint64_t
+xUSLMemRead64 (
+  const volatile void *Addr
+  )
+{
+  return UtFakeSpaceRead64 (MmioFakeSpace (), (uintptr_t)Addr);
 }
 
 void
@@ -43,7 +67,7 @@ xUSLMemWrite8 (
   uint8_t Value
   )
 {
-  MMIO[(size_t)Addr-MMIO_ADDRESS_MIN_MOCK_VAL] = Value;
+  UtFakeSpaceWrite8 (MmioFakeSpace (), (uintptr_t)Addr, Value);
 }
 
 void
@@ -52,7 +76,7 @@ xUSLMemWrite16 (
   uint16_t Value
   )
 {
-  *((uint16_t*)&MMIO[(size_t)Addr-MMIO_ADDRESS_MIN_MOCK_VAL]) = Value;
+  UtFakeSpaceWrite16 (MmioFakeSpace (), (uintptr_t)Addr, Value);
 }
 
 void
@@ -61,7 +85,16 @@ xUSLMemWrite32 (
   uint32_t Value
   )
 {
-  *((uint32_t*)&MMIO[(size_t)Addr-MMIO_ADDRESS_MIN_MOCK_VAL])= Value;
+  UtFakeSpaceWrite32 (MmioFakeSpace (), (uintptr_t)Addr, Value);
+}
+
+void
+xUSLMemWrite64 (
+  volatile void *Addr,
+  uint64_t Value
+  )
+{
+  UtFakeSpaceWrite64 (MmioFakeSpace (), (uintptr_t)Addr, Value);
 }
 
 void
@@ -4,24 +4,54 @@
  * @file  UtPcieFakeLib.c
  * @brief PCI/PCIe Fake Library
  *
+ * @details PCIe ECAM accesses are served by the UT_FAKE_SPACE_PCIE address
+ *          space of UtFakeMemLib. Any 64-bit address is valid; reads from
+ *          registers that were never written return the default value
+ *          (see UtPciExpressFakeSetDefaultValue).
  */
 
 #include <SilCommon.h>
 #include <Pci.h>
 #include <PciExpress.h>
+#include <Library/UtFakeMemLib.h>
 
-static uint8_t PCIEMMIO[PCIE_MMIO_ADDRESS_MAX_VAL-PCIE_MMIO_ADDRESS_MIN_VAL+1] = {0};
+static UT_FAKE_SPACE *mPcieSpace = NULL;
 
+static
+UT_FAKE_SPACE *
+PcieFakeSpace (
+  void
+  )
+{
+  if (mPcieSpace == NULL) {
+    mPcieSpace = UtFakeSpaceGet (UT_FAKE_SPACE_PCIE);
+  }
+  return mPcieSpace;
+}
+
+/**
+ * UtPciExpressFakeSetDefaultValue
+ * @brief Sets the byte value returned by reads from never-written registers.
+ *
+ * @details Registers that were already written keep their contents.
+ *          Use 0xFF to model absent devices.
+ *
+ * @param Value  Default byte value
+ */
+void
+UtPciExpressFakeSetDefaultValue (
+  uint8_t Value
+  )
+{
+  UtFakeSpaceSetDefaultValue (PcieFakeSpace (), Value);
+}
 
 uint8_t
 xUSLPciExpressRead8 (
   void *Addr
   )
 {
-  size_t Index;
-
-  Index = (size_t)Addr - PCIE_MMIO_ADDRESS_MIN_VAL;
-  return PCIEMMIO[Index];
+  return UtFakeSpaceRead8 (PcieFakeSpace (), (uintptr_t)Addr);
 }
 
 uint16_t
@@ -29,10 +59,7 @@ xUSLPciExpressRead16 (
   void *Addr
   )
 {
-  size_t Index;
-
-  Index = (size_t)Addr - PCIE_MMIO_ADDRESS_MIN_VAL;
-  return *((uint16_t*)&PCIEMMIO[Index]);
+  return UtFakeSpaceRead16 (PcieFakeSpace (), (uintptr_t)Addr);
 }
 
 uint32_t
@@ -40,10 +67,7 @@ xUSLPciExpressRead32 (
   void *Addr
   )
 {
-  size_t Index;
-
-  Index = (size_t)Addr - PCIE_MMIO_ADDRESS_MIN_VAL;
-  return *((uint32_t*)&PCIEMMIO[Index]);
+  return UtFakeSpaceRead32 (PcieFakeSpace (), (uintptr_t)Addr);
 }
 
 uint64_t
@@ -51,10 +75,7 @@ xUSLPciExpressRead64 (
   void *Addr
   )
 {
-  size_t Index;
-
-  Index = (size_t)Addr - PCIE_MMIO_ADDRESS_MIN_VAL;
-  return *((uint64_t*)&PCIEMMIO[Index]);
+  return UtFakeSpaceRead64 (PcieFakeSpace (), (uintptr_t)Addr);
 }
 
 void
@@ -63,10 +84,7 @@ xUSLPciExpressWrite8 (
   uint8_t Value
   )
 {
-  size_t Index;
-
-  Index = (size_t)Addr - PCIE_MMIO_ADDRESS_MIN_VAL;
-  PCIEMMIO[Index] = Value;
+  UtFakeSpaceWrite8 (PcieFakeSpace (), (uintptr_t)Addr, Value);
 }
 
 void
@@ -75,10 +93,7 @@ xUSLPciExpressWrite16 (
   uint16_t Value
   )
 {
-  size_t Index;
-
-  Index = (size_t)Addr - PCIE_MMIO_ADDRESS_MIN_VAL;
-  *((uint16_t*)&PCIEMMIO[Index]) = Value;
+  UtFakeSpaceWrite16 (PcieFakeSpace (), (uintptr_t)Addr, Value);
 }
 
 void
@@ -87,10 +102,7 @@ xUSLPciExpressWrite32 (
   uint32_t Value
   )
 {
-  size_t Index;
-
-  Index = (size_t)Addr - PCIE_MMIO_ADDRESS_MIN_VAL;
-  *((uint32_t*)&PCIEMMIO[Index]) = Value;
+  UtFakeSpaceWrite32 (PcieFakeSpace (), (uintptr_t)Addr, Value);
 }
 
 void
@@ -99,8 +111,5 @@ xUSLPciExpressWrite64 (
   uint64_t Value
   )
 {
-  size_t Index;
-
-  Index = (size_t)Addr - PCIE_MMIO_ADDRESS_MIN_VAL;
-  *((uint64_t*)&PCIEMMIO[Index]) = Value;
+  UtFakeSpaceWrite64 (PcieFakeSpace (), (uintptr_t)Addr, Value);
 }
@@ -10,6 +10,7 @@
 #include <Pci.h>
 #include <SmnAccess.h>
 #include <PciExpress.h>
+#include <Library/UtFakeMemLib.h>
 
 static
 uint64_t
@@ -22,50 +23,30 @@ PciReadWrite (
 {
   uint64_t          ReturnValue;
   uint64_t          PciAddr;
+  UT_FAKE_SPACE     *Space;
+  size_t            Length;
 
   if (Width != AccessWidth8 && Width != AccessWidth16 && Width != AccessWidth32 && Width != AccessWidth64) {
     assert (false);
     return 0;
   }
 
-  PciAddr = Address + 0xE0000000; // 32 bit PCIe Base for Fake
+  //
+  // The PCIe fake space is 64-bit wide, so the address is used as is instead of
+  // being squeezed through a (possibly 32-bit) pointer.
+  //
+  PciAddr = Address + PCIE_MMIO_ADDRESS_MIN_VAL;
+  Space   = UtFakeSpaceGet (UT_FAKE_SPACE_PCIE);
+  Length  = (size_t)1 << (Width - AccessWidth8);   // AccessWidth8..64 -> 1..8 bytes
 
   if (RW == PCI_READ) {
-    // Read
-    switch (Width) {
-    case AccessWidth8:
-      ReturnValue = xUSLPciExpressRead8 ((void*)(size_t)PciAddr);
-      break;
-    case AccessWidth16:
-      ReturnValue = xUSLPciExpressRead16 ((void*)(size_t)PciAddr);
-      break;
-    case AccessWidth32:
-      ReturnValue = xUSLPciExpressRead32 ((void*)(size_t)PciAddr);
-      break;
-    case AccessWidth64:
-      ReturnValue = xUSLPciExpressRead64 ((void*)(size_t)PciAddr);
-      break;
-    }
+    ReturnValue = 0;
+    UtFakeSpaceRead (Space, PciAddr, &ReturnValue, Length);
   } else {
-    // Write
-    switch (Width) {
-    case AccessWidth8:
-      xUSLPciExpressWrite8 ((void*)(size_t)PciAddr, (uint8_t)Value);
-      break;
-    case AccessWidth16:
-      xUSLPciExpressWrite16 ((void*)(size_t)PciAddr, (uint16_t)Value);
-      break;
-    case AccessWidth32:
-      xUSLPciExpressWrite32 ((void*)(size_t)PciAddr, (uint32_t)Value);
-      break;
-    case AccessWidth64:
-      xUSLPciExpressWrite64 ((void*)(size_t)PciAddr, (size_t)Value);
-      break;
-    }
+    UtFakeSpaceWrite (Space, PciAddr, &Value, Length);
     ReturnValue = 0;
   }
 
-
   return ReturnValue;
 }
 
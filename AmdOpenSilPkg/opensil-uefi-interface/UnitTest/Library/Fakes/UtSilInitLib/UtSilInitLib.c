@@ -10,10 +10,87 @@
 #include <string.h>
 #include <xSIM-api.h>
 #include <SilCommon.h>
+#include <UtSilInitLib.h>
+#include <Library/UtFakeMemLib.h>
 
 #define SIL_SERVICES_MEMORY_SIZE     (256*1024ul)
 void *mSilMemoryBase;
 
+static void   *mSilMemorySnapshot     = NULL;
+static size_t mSilMemorySnapshotSize  = 0;
+
+/**
+ * UtSilMemorySnapshot
+ * @brief Saves the used part of the host memory block (header and info blocks).
+ */
+static
+void
+UtSilMemorySnapshot (
+  void
+  )
+{
+  free (mSilMemorySnapshot);
+  mSilMemorySnapshot     = NULL;
+  mSilMemorySnapshotSize = 0;
+  if (mSilMemoryBase == NULL) {
+    return;
+  }
+  mSilMemorySnapshotSize = ((SIL_BLOCK_VARIABLES*)mSilMemoryBase)->FreeSpaceOffset;
+  mSilMemorySnapshot     = malloc (mSilMemorySnapshotSize);
+  if (mSilMemorySnapshot == NULL) {
+    mSilMemorySnapshotSize = 0;
+    return;
+  }
+  memcpy (mSilMemorySnapshot, mSilMemoryBase, mSilMemorySnapshotSize);
+}
+
+/**
+ * UtSilMemoryRestore
+ * @brief Copies the saved part of the host memory block back.
+ *
+ * @details Restoring the header also rewinds the free space, which drops every
+ *          info block created after the snapshot. The block is reallocated
+ *          if UtSilDeinit was called since.
+ */
+static
+void
+UtSilMemoryRestore (
+  void
+  )
+{
+  if (mSilMemorySnapshot == NULL) {
+    UtSilDeinit ();
+    return;
+  }
+  if ((mSilMemoryBase == NULL) && (UtSilInit () != SilPass)) {
+    return;
+  }
+  memcpy (mSilMemoryBase, mSilMemorySnapshot, mSilMemorySnapshotSize);
+}
+
+/**
+ * UtSilMemoryDiscard
+ * @brief Frees the saved copy of the host memory block.
+ */
+static
+void
+UtSilMemoryDiscard (
+  void
+  )
+{
+  free (mSilMemorySnapshot);
+  mSilMemorySnapshot     = NULL;
+  mSilMemorySnapshotSize = 0;
+}
+
+static const UT_FAKE_STATE_PROVIDER mSilMemoryProvider = {
+  "SilMemory",
+  UtSilMemorySnapshot,
+  UtSilMemoryRestore,
+  UtSilMemoryDiscard,
+  NULL
+};
+
 /**
  * UtSilInit
  * @brief Allocates the required memory on the host to accommodate
@@ -26,6 +103,7 @@ UtSilInit (
   void
   )
 {
+  UtFakeRegisterStateProvider (&mSilMemoryProvider);
   if (mSilMemoryBase != NULL) {
     // mSilMemoryBase is already allocated.
     return SilPass;
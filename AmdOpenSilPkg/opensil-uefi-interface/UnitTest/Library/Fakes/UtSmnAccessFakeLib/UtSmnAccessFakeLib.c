@@ -0,0 +1,105 @@
+/* Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved. */
+// SPDX-License-Identifier: MIT
+/**
+ * @file  UtSmnAccessFakeLib.c
+ * @brief SMN Access Fake Library
+ *
+ * @details SMN registers live in the UT_FAKE_SPACE_SMN address space of
+ *          UtFakeMemLib; segment and IOHC bus are folded into the upper
+ *          address bits (see UT_FAKE_SMN_ADDRESS), so every IOHC has its
+ *          own register file.
+ */
+
+#include <stdint.h>
+#include <SilCommon.h>
+#include <Library/UtFakeMemLib.h>
+
+static UT_FAKE_SPACE *mSmnSpace = NULL;
+
+static
+UT_FAKE_SPACE *
+SmnFakeSpace (
+  void
+  )
+{
+  if (mSmnSpace == NULL) {
+    mSmnSpace = UtFakeSpaceGet (UT_FAKE_SPACE_SMN);
+  }
+  return mSmnSpace;
+}
+
+uint32_t
+xUSLSmnRead (
+  uint32_t    SegmentNumber,
+  uint32_t    IohcBus,
+  uint32_t    SmnAddress
+  )
+{
+  return UtFakeSpaceRead32 (SmnFakeSpace (), UT_FAKE_SMN_ADDRESS (SegmentNumber, IohcBus, SmnAddress));
+}
+
+void
+xUSLSmnWrite (
+  uint32_t    SegmentNumber,
+  uint32_t    IohcBus,
+  uint32_t    SmnAddress,
+  uint32_t    Value
+  )
+{
+  UtFakeSpaceWrite32 (SmnFakeSpace (), UT_FAKE_SMN_ADDRESS (SegmentNumber, IohcBus, SmnAddress), Value);
+}
+
+void
+xUSLSmnReadModifyWrite (
+  uint32_t    SegmentNumber,
+  uint32_t    IohcBus,
+  uint32_t    SmnAddress,
+  uint32_t    AndMask,
+  uint32_t    OrMask
+  )
+{
+  xUSLSmnWrite (
+    SegmentNumber,
+    IohcBus,
+    SmnAddress,
+    (xUSLSmnRead (SegmentNumber, IohcBus, SmnAddress) & AndMask) | OrMask
+    );
+}
+
+uint8_t
+xUSLSmnRead8 (
+  uint32_t    SegmentNumber,
+  uint32_t    IohcBus,
+  uint32_t    SmnAddress
+  )
+{
+  return UtFakeSpaceRead8 (SmnFakeSpace (), UT_FAKE_SMN_ADDRESS (SegmentNumber, IohcBus, SmnAddress));
+}
+
+void
+xUSLSmnWrite8 (
+  uint32_t    SegmentNumber,
+  uint32_t    IohcBus,
+  uint32_t    SmnAddress,
+  uint8_t     Value8
+  )
+{
+  UtFakeSpaceWrite8 (SmnFakeSpace (), UT_FAKE_SMN_ADDRESS (SegmentNumber, IohcBus, SmnAddress), Value8);
+}
+
+void
+xUSLSmnReadModifyWrite8 (
+  uint32_t    SegmentNumber,
+  uint32_t    IohcBus,
+  uint32_t    SmnAddress,
+  uint8_t     AndMask,
+  uint8_t     OrMask
+  )
+{
+  xUSLSmnWrite8 (
+    SegmentNumber,
+    IohcBus,
+    SmnAddress,
+    (xUSLSmnRead8 (SegmentNumber, IohcBus, SmnAddress) & AndMask) | OrMask
+    );
+}
@@ -0,0 +1,27 @@
+/* Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved. */
+// SPDX-License-Identifier: MIT
+/**
+ * @file  UtStallFakeLib.c
+ * @brief Stall Fake Library
+ *
+ * @details The stall routines of the code under test advance the virtual
+ *          clock of UtTimerFakeLib instead of waiting, so delays and
+ *          timeouts cost no wall time.
+ */
+
+#include <stdint.h>
+#include <Library/UtTimerFakeLib.h>
+
+/**
+ * FchStall
+ * @brief Fake of the FCH stall: advances the virtual clock by uSec.
+ *
+ * @param uSec  Stall duration in microseconds
+ */
+void
+FchStall (
+  uint32_t uSec
+  )
+{
+  UtTimerFakeStall (uSec);
+}
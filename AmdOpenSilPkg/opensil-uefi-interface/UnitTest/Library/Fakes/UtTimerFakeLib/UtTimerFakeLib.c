@@ -0,0 +1,359 @@
+/* Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved. */
+// SPDX-License-Identifier: MIT
+/**
+ * @file  UtTimerFakeLib.c
+ * @brief Virtual-time clock for the fake address spaces
+ *
+ * @details The clock only moves when the code under test waits: on a stall,
+ *          or by the poll time on every read of a fake address space. Code
+ *          polling a status register with a timeout therefore reaches either
+ *          the scheduled status change or the timeout after a deterministic
+ *          number of reads, and the wall time spent is that of the reads.
+ *
+ *          Callbacks scheduled with UtTimerFakeSchedule run when the clock
+ *          passes their time, in time order, with the clock set to that time.
+ *          They typically flip status bits with UtFakeSpaceStore, or are
+ *          scheduled by register OnWrite handlers to model a completion
+ *          delay (see UtFakeSpaceAddRegisters).
+ *
+ *          The clock and pending callbacks are part of the fake state: they
+ *          return to zero and nothing with UtFakeResetAll, and to the
+ *          snapshot with UtFakeRestore. The library hooks itself into the
+ *          fake address spaces when the test binary is loaded, so the reads
+ *          of an iteration take the poll time before the test first uses the
+ *          clock.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include <UtBaseLib.h>
+#include <Library/UtFakeMemLib.h>
+#include <Library/UtTimerFakeLib.h>
+
+#define NANOSECONDS_PER_SECOND  1000000000ull
+
+typedef struct _UT_TIMER_FAKE_EVENT UT_TIMER_FAKE_EVENT;
+
+struct _UT_TIMER_FAKE_EVENT {
+  uint64_t                Time;
+  UT_TIMER_FAKE_CALLBACK  Callback;
+  void                    *Context;
+  UT_TIMER_FAKE_EVENT     *Next;
+};
+
+static uint64_t             mTimerNow         = 0;
+static uint64_t             mTimerPollTime    = UT_TIMER_FAKE_DEFAULT_POLL_TIME;
+static bool                 mTimerFiring      = false;
+static UT_TIMER_FAKE_EVENT  *mTimerEvents     = NULL;     ///< Sorted by time, FIFO for equal times
+
+static bool                 mTimerSnapshotTaken = false;
+static uint64_t             mTimerSnapshotNow   = 0;
+static UT_TIMER_FAKE_EVENT  *mTimerSnapshotEvents = NULL;
+
+/**
+ * UtTimerFakeFreeEvents
+ * @brief Frees an event list.
+ */
+static
+void
+UtTimerFakeFreeEvents (
+  UT_TIMER_FAKE_EVENT *Event
+  )
+{
+  UT_TIMER_FAKE_EVENT *Next;
+
+  for (; Event != NULL; Event = Next) {
+    Next = Event->Next;
+    free (Event);
+  }
+}
+
+/**
+ * UtTimerFakeCopyEvents
+ * @brief Duplicates an event list.
+ *
+ * @return Copy of the list; NULL if the list is empty or on allocation failure.
+ */
+static
+UT_TIMER_FAKE_EVENT *
+UtTimerFakeCopyEvents (
+  const UT_TIMER_FAKE_EVENT *Event
+  )
+{
+  UT_TIMER_FAKE_EVENT *Head;
+  UT_TIMER_FAKE_EVENT **Link;
+
+  Head = NULL;
+  Link = &Head;
+  for (; Event != NULL; Event = Event->Next) {
+    *Link = (UT_TIMER_FAKE_EVENT*) malloc (sizeof (UT_TIMER_FAKE_EVENT));
+    if (*Link == NULL) {
+      assert (false);
+      break;
+    }
+    **Link = *Event;
+    (*Link)->Next = NULL;
+    Link = &(*Link)->Next;
+  }
+  return Head;
+}
+
+static
+void
+UtTimerFakeSnapshot (
+  void
+  )
+{
+  UtTimerFakeFreeEvents (mTimerSnapshotEvents);
+  mTimerSnapshotEvents = UtTimerFakeCopyEvents (mTimerEvents);
+  mTimerSnapshotNow    = mTimerNow;
+  mTimerSnapshotTaken  = true;
+}
+
+static
+void
+UtTimerFakeRestore (
+  void
+  )
+{
+  if (!mTimerSnapshotTaken) {
+    return;
+  }
+  UtTimerFakeFreeEvents (mTimerEvents);
+  mTimerEvents = UtTimerFakeCopyEvents (mTimerSnapshotEvents);
+  mTimerNow    = mTimerSnapshotNow;
+}
+
+static
+void
+UtTimerFakeDiscard (
+  void
+  )
+{
+  UtTimerFakeFreeEvents (mTimerSnapshotEvents);
+  mTimerSnapshotEvents = NULL;
+  mTimerSnapshotTaken  = false;
+}
+
+static
+void
+UtTimerFakeReset (
+  void
+  )
+{
+  UtTimerFakeFreeEvents (mTimerEvents);
+  mTimerEvents   = NULL;
+  mTimerNow      = 0;
+  mTimerPollTime = UT_TIMER_FAKE_DEFAULT_POLL_TIME;
+}
+
+static const UT_FAKE_STATE_PROVIDER mTimerProvider = {
+  "Timer",
+  UtTimerFakeSnapshot,
+  UtTimerFakeRestore,
+  UtTimerFakeDiscard,
+  UtTimerFakeReset
+};
+
+/**
+ * UtTimerFakeOnRead
+ * @brief Fake address-space read hook; a register poll takes the poll time.
+ */
+static
+void
+UtTimerFakeOnRead (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address
+  )
+{
+  if (!mTimerFiring && (mTimerPollTime != 0)) {
+    UtTimerFakeAdvance (mTimerPollTime);
+  }
+}
+
+/**
+ * UtTimerFakeLibConstructor
+ * @brief Hooks the clock into the fake address spaces.
+ *
+ * @details Runs when the test binary is loaded, like the UtFakeMemLib one,
+ *          so that no register read goes without its poll time.
+ */
+AMD_UNIT_TEST_CONSTRUCTOR (UtTimerFakeLibConstructor)
+{
+  UtFakeRegisterStateProvider (&mTimerProvider);
+  UtFakeSetReadHook (UtTimerFakeOnRead);
+}
+
+/**
+ * UtTimerFakeGetTime
+ * @brief Returns the virtual time in nanoseconds since the start of the iteration.
+ */
+uint64_t
+UtTimerFakeGetTime (
+  void
+  )
+{
+  return mTimerNow;
+}
+
+/**
+ * UtTimerFakeAdvance
+ * @brief Moves the virtual clock forward, running the callbacks that become due.
+ *
+ * @param Nanoseconds  Time to advance by
+ */
+void
+UtTimerFakeAdvance (
+  uint64_t  Nanoseconds
+  )
+{
+  UT_TIMER_FAKE_EVENT *Event;
+  uint64_t            Target;
+  bool                WasFiring;
+
+  Target = mTimerNow + Nanoseconds;
+  while ((mTimerEvents != NULL) && (mTimerEvents->Time <= Target)) {
+    Event        = mTimerEvents;
+    mTimerEvents = Event->Next;
+    if (Event->Time > mTimerNow) {
+      mTimerNow = Event->Time;
+    }
+    WasFiring    = mTimerFiring;
+    mTimerFiring = true;
+    Event->Callback (Event->Context);
+    mTimerFiring = WasFiring;
+    free (Event);
+  }
+  if (Target > mTimerNow) {
+    mTimerNow = Target;
+  }
+}
+
+/**
+ * UtTimerFakeStall
+ * @brief Fake stall: advances the virtual clock instead of waiting.
+ *
+ * @details The stall routines of the code under test forward here (see
+ *          UtStallFakeLib).
+ *
+ * @param Microseconds  Stall duration
+ */
+void
+UtTimerFakeStall (
+  uint64_t  Microseconds
+  )
+{
+  UtTimerFakeAdvance (Microseconds * 1000);
+}
+
+/**
+ * UtTimerFakeSetPollTime
+ * @brief Sets the virtual time every read of a fake address space takes.
+ *
+ * @details Reset to UT_TIMER_FAKE_DEFAULT_POLL_TIME between iterations.
+ *          0 stops register reads from advancing the clock.
+ *
+ * @param Nanoseconds  Time per read
+ */
+void
+UtTimerFakeSetPollTime (
+  uint64_t  Nanoseconds
+  )
+{
+  mTimerPollTime = Nanoseconds;
+}
+
+/**
+ * UtTimerFakeSchedule
+ * @brief Runs Callback once the virtual clock has advanced by Delay.
+ *
+ * @details Callbacks due at the same time run in the order they were
+ *          scheduled. A callback may schedule further callbacks.
+ *
+ * @param Delay     Nanoseconds from now
+ * @param Callback  Function to run
+ * @param Context   Passed to Callback
+ *
+ * @retval true   Callback scheduled
+ * @retval false  Out of memory
+ */
+bool
+UtTimerFakeSchedule (
+  uint64_t                Delay,
+  UT_TIMER_FAKE_CALLBACK  Callback,
+  void                    *Context
+  )
+{
+  UT_TIMER_FAKE_EVENT *Event;
+  UT_TIMER_FAKE_EVENT **Link;
+
+  Event = (UT_TIMER_FAKE_EVENT*) malloc (sizeof (UT_TIMER_FAKE_EVENT));
+  if (Event == NULL) {
+    assert (false);
+    return false;
+  }
+  Event->Time     = mTimerNow + Delay;
+  Event->Callback = Callback;
+  Event->Context  = Context;
+  Link = &mTimerEvents;
+  while ((*Link != NULL) && ((*Link)->Time <= Event->Time)) {
+    Link = &(*Link)->Next;
+  }
+  Event->Next = *Link;
+  *Link       = Event;
+  return true;
+}
+
+/**
+ * UtTimerFakeReadCounter
+ * @brief OnRead handler of a counter register.
+ */
+static
+void
+UtTimerFakeReadCounter (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint64_t      *Value,
+  void          *Context
+  )
+{
+  uint64_t  Frequency;
+
+  Frequency = (uintptr_t)Context;
+  *Value = (mTimerNow / NANOSECONDS_PER_SECOND) * Frequency +
+           (mTimerNow % NANOSECONDS_PER_SECOND) * Frequency / NANOSECONDS_PER_SECOND;
+}
+
+/**
+ * UtTimerFakeAddCounter
+ * @brief Models a free-running, read-only counter register driven by the virtual clock.
+ *
+ * @details E.g. the ACPI PM timer with UT_TIMER_FAKE_ACPI_PM_FREQUENCY, so
+ *          delay loops reading it finish after the virtual time they wait
+ *          for. The counter wraps at the register width. Like any register
+ *          model it is removed by a reset.
+ *
+ * @param Space      Address space
+ * @param Address    Register address (aligned to Width)
+ * @param Width      Register width in bytes: 1, 2, 4 or 8
+ * @param Frequency  Counter frequency in Hz
+ *
+ * @retval true   Counter added
+ * @retval false  See UtFakeSpaceAddRegisters
+ */
+bool
+UtTimerFakeAddCounter (
+  UT_FAKE_SPACE *Space,
+  uint64_t      Address,
+  uint8_t       Width,
+  uint32_t      Frequency
+  )
+{
+  UT_FAKE_REGISTER Counter = {0};
+
+  Counter.Width        = Width;
+  Counter.ReadOnlyMask = ~0ull;
+  Counter.OnRead       = UtTimerFakeReadCounter;
+  Counter.Context      = (void*)(uintptr_t)Frequency;
+  return UtFakeSpaceAddRegisters (Space, Address, Width, &Counter);
+}
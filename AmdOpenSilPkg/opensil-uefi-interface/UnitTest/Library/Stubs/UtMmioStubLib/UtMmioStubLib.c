@@ -33,6 +33,14 @@ xUSLMemRead32 (
   return 0x00;
 }
 
+uint64_t
+xUSLMemRead64 (
+  const volatile void *Addr
+  )
+{
+  return 0x00;
+}
+
 void
 xUSLMemWrite8 (
   volatile void *Addr,
@@ -60,6 +68,15 @@ xUSLMemWrite32 (
   return;
 }
 
+void
+xUSLMemWrite64 (
+  volatile void *Addr,
+  uint64_t Value
+  )
+{
+  return;
+}
+
 void
 xUSLMemReadModifyWrite8 (
   void *Addr,
@@ -15,6 +15,35 @@
 #define AMD_UNIT_TEST_MAX_PATH_LENGTH               256
 #define AMD_UNIT_TEST_MAX_STRING_LENGTH             120
 #define AMD_UNIT_TEST_MAX_CONFIG_FILE_LENGTH        (1024*128)
+#define AMD_UNIT_TEST_MAX_RESET_HANDLERS            8
+#define AMD_UNIT_TEST_MAX_SETUP_HANDLERS            8
+
+//
+// Defines a function run when the test binary is loaded, before main. Fakes
+// use it to register their setup and reset handlers before the first
+// iteration starts:
+//   AMD_UNIT_TEST_CONSTRUCTOR (MyFakeConstructor)
+//   {
+//     UtRegisterResetHandler (MyFakeReset);
+//   }
+//
+#if defined(_MSC_VER)
+#pragma section(".CRT$XCU", read)
+#if defined(_M_IX86)
+#define AMD_UNIT_TEST_SYMBOL_PREFIX                 "_"
+#else
+#define AMD_UNIT_TEST_SYMBOL_PREFIX                 ""
+#endif
+#define AMD_UNIT_TEST_CONSTRUCTOR(Function) \
+  static void Function (void); \
+  __declspec(allocate(".CRT$XCU")) void (*Function##Entry) (void) = Function; \
+  __pragma(comment(linker, "/include:" AMD_UNIT_TEST_SYMBOL_PREFIX #Function "Entry")) \
+  static void Function (void)
+#else
+#define AMD_UNIT_TEST_CONSTRUCTOR(Function) \
+  static void Function (void) __attribute__((constructor)); \
+  static void Function (void)
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -64,6 +93,20 @@ UtRunTest (
   AMD_UNIT_TEST_FRAMEWORK *Ut
   );
 
+int
+UtRunTestEntry (
+  AMD_UNIT_TEST_FRAMEWORK   *Ut,
+  const AMD_UNIT_TEST_ENTRY *Test
+  );
+
+AMD_UNIT_TEST_STATUS
+UtRunTestTable (
+  int                       argc,
+  char                      *argv[],
+  const AMD_UNIT_TEST_ENTRY *Tests,
+  uint32_t                  TestCount
+  );
+
 void
 UtDeinit (
   AMD_UNIT_TEST_FRAMEWORK *Ut
@@ -87,6 +130,16 @@ UtAddElementToResult (
   const char              *Value
   );
 
+AMD_UNIT_TEST_STATUS
+UtRegisterResetHandler (
+  AMD_UNIT_TEST_RESET_HANDLER Handler
+  );
+
+AMD_UNIT_TEST_STATUS
+UtRegisterSetupHandler (
+  AMD_UNIT_TEST_SETUP_HANDLER Handler
+  );
+
 #ifdef __cplusplus
 }
 #endif
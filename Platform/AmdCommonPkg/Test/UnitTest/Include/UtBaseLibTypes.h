@@ -22,7 +22,8 @@ typedef enum {
   AMD_UNIT_TEST_PASSED,
   AMD_UNIT_TEST_FAILED,
   AMD_UNIT_TEST_ABORTED,
-  AMD_UNIT_TEST_STATUS_NOT_SET
+  AMD_UNIT_TEST_STATUS_NOT_SET,
+  AMD_UNIT_TEST_TIMEOUT                               ///< Set by the watchdog (-w) only
 } AMD_UNIT_TEST_STATUS;
 
 typedef
@@ -48,8 +49,26 @@ typedef struct {
   AMD_UNIT_TEST_FUNCTION     TestFunc;
   AMD_UNIT_TEST_PREREQUISITE PrereqFunc;
   AMD_UNIT_TEST_CONTEXT      Context;
+  uint32_t                   IterationIndex;
 } AMD_UNIT_TEST_WRAPPER;
 
+///
+/// Unit test of a test table binary (see UtRunTestTable)
+///
+typedef struct {
+  const char                 *Name;               ///< Test name, selected with -t
+  AMD_UNIT_TEST_PREREQUISITE Prerequisite;
+  AMD_UNIT_TEST_FUNCTION     Body;
+  AMD_UNIT_TEST_CLEANUP      CleanUp;
+  AMD_UNIT_TEST_CONTEXT      Context;             ///< Passed to the test functions
+} AMD_UNIT_TEST_ENTRY;
+
+typedef
+void
+(*AMD_UNIT_TEST_RESET_HANDLER)(
+  void
+  );
+
 typedef void (*AMD_UNIT_TEST_LOGGER) (
   int         MsgLevel,
   const char  *file,
@@ -72,4 +91,18 @@ typedef struct {
   cJSON                      *TestResultRoot;
   AMD_UNIT_TEST_STATUS       TestStatus;
   AMD_UNIT_TEST_LOGGER       Log;
+  char                       *TestOutputRoot;       ///< -o directory when several iterations run, NULL otherwise
+  FILE                       *SessionLogFile;       ///< Log of the whole run when several iterations run
+  cJSON                      **TestIterations;      ///< Configurations of the iterations selected by -i
+  uint32_t                   TestIterationCount;
+  uint32_t                   TestIterationIndex;    ///< Index of the current iteration in TestIterations
+  bool                       ForkIterations;        ///< -f: run each iteration in a forked child process
+  bool                       WorkerMode;            ///< --worker: serve run requests from the standard input
+  uint32_t                   WatchdogTimeout;       ///< -w: seconds an iteration may run, 0 for no limit
 } AMD_UNIT_TEST_FRAMEWORK;
+
+typedef
+void
+(*AMD_UNIT_TEST_SETUP_HANDLER)(
+  AMD_UNIT_TEST_FRAMEWORK  *Ut
+  );
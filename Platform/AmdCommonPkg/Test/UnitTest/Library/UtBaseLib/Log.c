@@ -24,6 +24,7 @@
 
 #include <Library/PrintLib.h>
 #include "Log.h"
+#include "UtBaseLibCrt.h"
 
 #define MAX_CALLBACKS 32
 #define MAX_LOG_MESSAGE_LENGTH  0x100
@@ -40,6 +41,8 @@ static struct {
   int level;
   bool quiet;
   Callback callbacks[MAX_CALLBACKS];
+  const char *last_file;  // Location of the last message, see log_last_location
+  int last_line;
 } L;
 
 
@@ -55,11 +58,12 @@ static const char *level_colors[] = {
 
 static void print_message_with_format(log_Event *event) {
   switch (event->std) {
-    case STRING_FMT_EDK2_PRINT_LIB:
+    case STRING_FMT_EDK2_PRINT_LIB: {
       char buffer[MAX_LOG_MESSAGE_LENGTH];
       AsciiVSPrint(buffer, sizeof(buffer), event->fmt, event->ap);
       fputs(buffer, event->udata);
       break;
+    }
 
     case STRING_FMT_ANSI_C_STD:
     default:
@@ -163,6 +167,19 @@ int log_add_fp(FILE *fp, int level) {
 }
 
 
+void log_remove_fp(FILE *fp) {
+  int i, j;
+  for (i = 0, j = 0; i < MAX_CALLBACKS && L.callbacks[i].fn; i++) {
+    if (L.callbacks[i].fn != file_callback || L.callbacks[i].udata != fp) {
+      L.callbacks[j++] = L.callbacks[i];
+    }
+  }
+  for (; j < i; j++) {
+    L.callbacks[j] = (Callback) { NULL, NULL, 0 };
+  }
+}
+
+
 static void init_event(log_Event *ev, void *udata) {
   // SA: Workaround for using localtime_s
   time_t t = time(NULL);
@@ -171,6 +188,12 @@ static void init_event(log_Event *ev, void *udata) {
 }
 
 
+void log_last_location(const char **file, int *line) {
+  *file = L.last_file;
+  *line = L.last_line;
+}
+
+
 void log_log(int level, const char *file, int line, const char *fmt, ...) {
   log_Event ev = {
     .std   = STRING_FMT_ANSI_C_STD,
@@ -184,6 +207,11 @@ void log_log(int level, const char *file, int line, const char *fmt, ...) {
 
   lock();
 
+  if (line != 0) {
+    L.last_file = file;
+    L.last_line = line;
+  }
+
   ev.time = &_time;  // SA: Workaround for using localtime_s
 
   if (!L.quiet && level >= L.level) {
@@ -219,19 +247,27 @@ void log_log_sil(int level, const char *file, int line, const char *fmt, va_list
 
   lock();
 
+  if (line != 0) {
+    L.last_file = file;
+    L.last_line = line;
+  }
+
   ev.time = &_time;  // SA: Workaround for using localtime_s
 
   if (!L.quiet && level >= L.level) {
     init_event(&ev, stderr);
-    ev.ap = ap;
+    va_copy(ev.ap, ap);
     stdout_callback(&ev);
+    va_end(ev.ap);
   }
 
   for (int i = 0; i < MAX_CALLBACKS && L.callbacks[i].fn; i++) {
     Callback *cb = &L.callbacks[i];
     if (level >= cb->level) {
       init_event(&ev, cb->udata);
+      va_copy(ev.ap, ap);
       cb->fn(&ev);
+      va_end(ev.ap);
     }
   }
 
@@ -50,5 +50,7 @@ void log_set_level(int level);
 void log_set_quiet(bool enable);
 int log_add_callback(log_LogFn fn, void *udata, int level);
 int log_add_fp(FILE *fp, int level);
+void log_remove_fp(FILE *fp);
+void log_last_location(const char **file, int *line);
 void log_log(int level, const char *file, int line, const char *fmt, ...);
 void log_log_sil(int level, const char *file, int line, const char *fmt, va_list ap);
@@ -17,12 +17,76 @@
 #include <UtBaseLib.h>
 #include <UtLogLib.h>
 #include "Log.h"
+#include "UtWatchdog.h"
+#include "UtBaseLibCrt.h"
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <io.h>
+#define UT_PATH_SEPARATOR       "\\"
+#define UtMakeDirectory(Path)   _mkdir (Path)
+#define UtDup(Fd)               _dup (Fd)
+#define UtDup2(Fd, Fd2)         _dup2 (Fd, Fd2)
+#define UtFdOpen(Fd, Mode)      _fdopen (Fd, Mode)
+#define UtFileNo(File)          _fileno (File)
+#else
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define UT_PATH_SEPARATOR       "/"
+#define UtMakeDirectory(Path)   mkdir (Path, 0755)
+#define UtDup(Fd)               dup (Fd)
+#define UtDup2(Fd, Fd2)         dup2 (Fd, Fd2)
+#define UtFdOpen(Fd, Mode)      fdopen (Fd, Mode)
+#define UtFileNo(File)          fileno (File)
+#endif
+
+#define AMD_UNIT_TEST_ALL_ITERATIONS            "*"
+#define AMD_UNIT_TEST_ITERATION_SEPARATOR       ','
+#define AMD_UNIT_TEST_ALL_TESTS                 "*"
+#define AMD_UNIT_TEST_TEST_SEPARATOR            ','
 
 static AMD_UNIT_TEST_FRAMEWORK_HANDLE ActiveFramework = NULL;
+static AMD_UNIT_TEST_RESET_HANDLER    ResetHandlers[AMD_UNIT_TEST_MAX_RESET_HANDLERS];
+static uint32_t                       ResetHandlerCount = 0;
+static AMD_UNIT_TEST_SETUP_HANDLER    SetupHandlers[AMD_UNIT_TEST_MAX_SETUP_HANDLERS];
+static uint32_t                       SetupHandlerCount = 0;
+static bool                           IterationActive = false;
+static bool                           TestBodyReturned = false;
+static bool                           ForkedIteration = false;
+
+//
+// What UtWatchdogExpired writes when the iteration times out. It is prepared
+// while the iteration runs: the watchdog may stop it anywhere, e.g. in malloc
+// or holding a stdio lock, so the expiry only adds the elapsed time and the
+// last trace point.
+//
+#define UT_TIMEOUT_PREFIX_LENGTH        96
+#define UT_TIMEOUT_RESULT_MIN_CAPACITY  1024
+
+typedef struct {
+  char              *Text;                ///< Iteration result printed so far, without its closing brace
+  size_t            Length;               ///< Characters of Text written, no terminator
+  size_t            Capacity;             ///< Size of Text
+} UT_TIMEOUT_RESULT;
 
-extern AMD_UNIT_TEST_STATUS TestPrerequisite (AMD_UNIT_TEST_CONTEXT Context);
-extern void                 TestBody (AMD_UNIT_TEST_CONTEXT Context);
-extern AMD_UNIT_TEST_STATUS TestCleanUp (AMD_UNIT_TEST_CONTEXT Context);
+typedef struct {
+  bool              Armed;
+  UT_TIMEOUT_RESULT Results[2];           ///< Appended to in place, or copied to the other one to grow
+  volatile int      Result;               ///< Index of the one in use in Results
+  UT_WATCHDOG_FILE  ResultFile;
+  UT_WATCHDOG_FILE  LogFile;
+  UT_WATCHDOG_FILE  SessionLogFile;
+  UT_WATCHDOG_FILE  ErrorFile;
+  char              LogPrefix[UT_TIMEOUT_PREFIX_LENGTH];
+  char              ErrorPrefix[UT_TIMEOUT_PREFIX_LENGTH];
+  char              Message[AMD_UNIT_TEST_MAX_STRING_LENGTH];   ///< Message up to the elapsed time
+  char              Timeout[AMD_UNIT_TEST_MAX_STRING_LENGTH];   ///< Message from the elapsed time to the trace point
+  UT_WATCHDOG_FILE  WorkerFile;
+  char              *WorkerResponse;      ///< Response to the request being run, NULL for none
+} UT_TIMEOUT_REPORT;
+
+static UT_TIMEOUT_REPORT              TimeoutReport;
 
 static
 void UtSetActiveFrameworkHandle (
@@ -42,6 +106,18 @@ UtUsage (
   printf ("  %s -i \"Test Iteration Name\" -o \"Absolute Path to Test Output Directory\"", TestName);
   printf (" -c \"Absolute Path to Test Configuration File\"");
   printf ("\nOPTIONS:\n");
+  printf ("  -i           Iteration to run. A comma separated list or * runs several iterations,\n");
+  printf ("               each writing its results to a sub-directory of the output directory.\n");
+  printf ("  -f           Fork-server mode: run each iteration in a child process forked from the\n");
+  printf ("               initialized test, so that iterations cannot affect each other.\n");
+  printf ("  -t           Test table binaries only: comma separated list of tests to run (default *).\n");
+  printf ("               When several tests run, -c is the directory of their configuration files\n");
+  printf ("               and each test writes its results to a sub-directory of the output directory.\n");
+  printf ("  -w           Watchdog: seconds an iteration may run. When they are over, the iteration\n");
+  printf ("               result is written with status TIMEOUT and the test exits.\n");
+  printf ("  --worker     Serve run requests: read one JSON request per line on the standard input\n");
+  printf ("               and write one JSON response per line on the standard output. -i and -o\n");
+  printf ("               are given by each request.\n");
   printf ("  -h, --help   Print This Help Message.\n");
 }
 
@@ -58,32 +134,49 @@ UtWrite2ResultFile (
 
 static
 AMD_UNIT_TEST_STATUS
-UtSetTestNameFromArgs (
+UtSetTestName (
   AMD_UNIT_TEST_FRAMEWORK *Ut,
-  int  argc,
-  char *argv[]
+  const char              *Name
   )
 {
-  char *LastBackSlash;
-  char *Extension;
   Ut->TestName = (char*) malloc (AMD_UNIT_TEST_MAX_FILENAME_LENGTH);
   if (Ut->TestName == NULL) {
     printf ("UtInitFromArgs failed to allocate memory dynamically.\n");
     return AMD_UNIT_TEST_ABORTED;
   }
+  if (strcpy_s (Ut->TestName, AMD_UNIT_TEST_MAX_FILENAME_LENGTH, Name) != 0x00) {
+    printf ("UtInitFromArgs failed to set test name.\n");
+    free (Ut->TestName);
+    Ut->TestName = NULL;
+    return AMD_UNIT_TEST_ABORTED;
+  }
+  return AMD_UNIT_TEST_PASSED;
+}
+
+static
+AMD_UNIT_TEST_STATUS
+UtSetTestNameFromArgs (
+  AMD_UNIT_TEST_FRAMEWORK *Ut,
+  int  argc,
+  char *argv[]
+  )
+{
+  AMD_UNIT_TEST_STATUS Status;
+  char *LastBackSlash;
+  char *LastSlash;
+  char *Extension;
   LastBackSlash = strrchr(argv[0], '\\');
+  LastSlash     = strrchr(argv[0], '/');
+  if ((LastBackSlash == NULL) || ((LastSlash != NULL) && (LastSlash > LastBackSlash))) {
+    LastBackSlash = LastSlash;
+  }
   if (LastBackSlash == NULL) {
-    if (strcpy_s (Ut->TestName, AMD_UNIT_TEST_MAX_FILENAME_LENGTH, argv[0]) != 0x00) {
-      printf ("UtInitFromArgs failed to set test name.\n");
-      free (Ut->TestName);
-      return AMD_UNIT_TEST_ABORTED;
-    }
+    Status = UtSetTestName (Ut, argv[0]);
   } else {
-    if (strcpy_s (Ut->TestName, AMD_UNIT_TEST_MAX_FILENAME_LENGTH, LastBackSlash+1) != 0x00) {
-      printf ("UtInitFromArgs failed to set test name.\n");
-      free (Ut->TestName);
-      return AMD_UNIT_TEST_ABORTED;
-    }
+    Status = UtSetTestName (Ut, LastBackSlash+1);
+  }
+  if (Status != AMD_UNIT_TEST_PASSED) {
+    return Status;
   }
   Extension = strrchr (Ut->TestName, '.');
   if (Extension != NULL) {
@@ -108,7 +201,7 @@ UtInitTestLogger (
   }
   LogFilePath = (char*) malloc (AMD_UNIT_TEST_MAX_PATH_LENGTH);
   strcpy_s (LogFilePath, AMD_UNIT_TEST_MAX_PATH_LENGTH, Ut->TestOutpath);
-  strcat_s (LogFilePath, AMD_UNIT_TEST_MAX_PATH_LENGTH, "\\");
+  strcat_s (LogFilePath, AMD_UNIT_TEST_MAX_PATH_LENGTH, UT_PATH_SEPARATOR);
   strcat_s (LogFilePath, AMD_UNIT_TEST_MAX_PATH_LENGTH, Ut->TestName);
   strcat_s (LogFilePath, AMD_UNIT_TEST_MAX_PATH_LENGTH, ".log");
   if (fopen_s (&Ut->LogFile, LogFilePath, "w") != 0) {
@@ -138,7 +231,7 @@ UtInitTestResult (
   }
   ResFilePath = (char*) malloc (AMD_UNIT_TEST_MAX_PATH_LENGTH);
   strcpy_s (ResFilePath, AMD_UNIT_TEST_MAX_PATH_LENGTH, Ut->TestOutpath);
-  strcat_s (ResFilePath, AMD_UNIT_TEST_MAX_PATH_LENGTH, "\\");
+  strcat_s (ResFilePath, AMD_UNIT_TEST_MAX_PATH_LENGTH, UT_PATH_SEPARATOR);
   strcat_s (ResFilePath, AMD_UNIT_TEST_MAX_PATH_LENGTH, Ut->TestName);
   strcat_s (ResFilePath, AMD_UNIT_TEST_MAX_PATH_LENGTH, ".json");
   if (fopen_s (&Ut->ResultFile, ResFilePath, "w") != 0) {
@@ -153,13 +246,118 @@ UtInitTestResult (
   return AMD_UNIT_TEST_PASSED;
 }
 
+static
+const char *
+UtGetIterationName (
+  cJSON *Iteration
+  )
+{
+  return cJSON_GetObjectItemCaseSensitive (Iteration, "Iteration")->valuestring;
+}
+
+/**
+ * UtFindIterations
+ * @brief Looks up the iterations selected by the -i argument in the test configuration.
+ *
+ * @details -i names one iteration, a comma separated list of iterations, or
+ *          all of them with "*". The selected iterations are stored in
+ *          TestIterations in the order they will run.
+ *
+ * @param Ut    Test framework
+ * @param Root  Parsed test configuration (array of iterations)
+ *
+ * @retval AMD_UNIT_TEST_PASSED   Every selected iteration was found
+ * @retval AMD_UNIT_TEST_ABORTED  Malformed configuration or unknown iteration
+ */
+static
+AMD_UNIT_TEST_STATUS
+UtFindIterations (
+  AMD_UNIT_TEST_FRAMEWORK *Ut,
+  cJSON                   *Root
+  )
+{
+  cJSON       *Child;
+  cJSON       *Iteration;
+  const char  *Name;
+  const char  *End;
+  size_t      Length;
+  uint32_t    MaxCount;
+
+  for (Child = Root->child; Child != NULL; Child = Child->next) {
+    Iteration = cJSON_GetObjectItemCaseSensitive(Child, "Iteration");
+    if (Iteration == NULL) {
+      Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+        "Unexpected test configuration format (root with empty child found).");
+      return AMD_UNIT_TEST_ABORTED;
+    } else if (cJSON_IsString(Iteration) == false) {
+      Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+        "Unexpected test configuration format ('Iteration' key is not a string object).");
+      return AMD_UNIT_TEST_ABORTED;
+    } else if (Iteration->valuestring == NULL) {
+      Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+        "Unexpected test configuration format ('Iteration' key valuestring is NULL).");
+      return AMD_UNIT_TEST_ABORTED;
+    }
+  }
+
+  MaxCount = (uint32_t) cJSON_GetArraySize(Root) + 1;
+  for (Name = Ut->TestIteration; *Name != '\0'; Name++) {
+    if (*Name == AMD_UNIT_TEST_ITERATION_SEPARATOR) {
+      MaxCount++;
+    }
+  }
+  Ut->TestIterations = (cJSON**) malloc (MaxCount * sizeof (cJSON*));
+  if (Ut->TestIterations == NULL) {
+    printf ("UtInitFromArgs failed to allocate memory dynamically.\n");
+    return AMD_UNIT_TEST_ABORTED;
+  }
+  Ut->TestIterationCount = 0;
+
+  if (strcmp (Ut->TestIteration, AMD_UNIT_TEST_ALL_ITERATIONS) == 0) {
+    for (Child = Root->child; Child != NULL; Child = Child->next) {
+      Ut->TestIterations[Ut->TestIterationCount++] = Child;
+    }
+  } else {
+    Name = Ut->TestIteration;
+    while (true) {
+      End    = strchr (Name, AMD_UNIT_TEST_ITERATION_SEPARATOR);
+      Length = (End == NULL) ? strlen (Name) : (size_t)(End - Name);
+      for (Child = Root->child; Child != NULL; Child = Child->next) {
+        if ((strlen (UtGetIterationName (Child)) == Length) && (strncmp (UtGetIterationName (Child), Name, Length) == 0)) {
+          break;
+        }
+      }
+      if (Child == NULL) {
+        Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+          "Failed to find iteration '%.*s' in test configuration file.", (int) Length, Name);
+        return AMD_UNIT_TEST_ABORTED;
+      }
+      Ut->Log(AMD_UNIT_TEST_LOG_INFO, __FUNCTION__, __LINE__,
+        "Iteration %s found.", UtGetIterationName (Child));
+      Ut->TestIterations[Ut->TestIterationCount++] = Child;
+      if (End == NULL) {
+        break;
+      }
+      Name = End + 1;
+    }
+  }
+
+  if (Ut->TestIterationCount == 0) {
+    Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+      "No iteration selected by '%s'.", Ut->TestIteration);
+    return AMD_UNIT_TEST_ABORTED;
+  }
+  return AMD_UNIT_TEST_PASSED;
+}
+
 static
 AMD_UNIT_TEST_STATUS
 UtInitTestConfigs  (
   AMD_UNIT_TEST_FRAMEWORK *Ut
   )
 {
-  bool IterationFound = false;
+  AMD_UNIT_TEST_STATUS Status;
+
   if (fopen_s (&Ut->ConfigFile, Ut->TestConfigFile, "r") != 0) {
     printf ("Failed to open test configuration file (i.e., %s).\n", Ut->TestConfigFile);
     Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
@@ -188,6 +386,7 @@ UtInitTestConfigs  (
     Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
       "Unexpected test configuration format (root must be an array object).");
     cJSON_Delete(root);
+    return AMD_UNIT_TEST_ABORTED;
   } else if (cJSON_GetArraySize(root) == 0) {
     Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
       "Test configuration file must have at least one iteration (current size is 0).");
@@ -195,40 +394,14 @@ UtInitTestConfigs  (
     return AMD_UNIT_TEST_ABORTED;
   }
 
-  cJSON *child = root->child;
-  while (child != NULL) {
-    cJSON *Iteration = cJSON_GetObjectItemCaseSensitive(child, "Iteration");
-    if (Iteration == NULL) {
-      Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
-        "Unexpected test configuration format (root with empty child found).");
-      cJSON_Delete(root);
-      return AMD_UNIT_TEST_ABORTED;
-    } else if (cJSON_IsString(Iteration) == false) {
-      Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
-        "Unexpected test configuration format ('Iteration' key is not a string object).");
-      break;
-    } else if (Iteration->valuestring == NULL) {
-      Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
-        "Unexpected test configuration format ('Iteration' key valuestring is NULL).");
-      break;
-    } else if (strcmp (Iteration->valuestring, Ut->TestIteration) == 0) {
-      Ut->Log(AMD_UNIT_TEST_LOG_INFO, __FUNCTION__, __LINE__,
-        "Iteration %s found.", Ut->TestIteration);
-      IterationFound = true;
-      break;
-    }
-    child = child->next;
-  }
-
-  if (IterationFound == false) {
-    Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
-      "Failed to find iteration '%s' in test configuration file.", Ut->TestIteration);
+  Status = UtFindIterations (Ut, root);
+  if (Status != AMD_UNIT_TEST_PASSED) {
     cJSON_Delete(root);
-    return AMD_UNIT_TEST_ABORTED;
+    return Status;
   }
 
   Ut->TestConfigRoot = root;
-  Ut->TestConfigIteration = child;
+  Ut->TestConfigIteration = Ut->TestIterations[0];
 
   return AMD_UNIT_TEST_PASSED;
 }
@@ -259,26 +432,45 @@ UtGetTestConfig  (
 static
 AMD_UNIT_TEST_STATUS
 UtParseArgs (
-  int   argc,
-  char  *argv[],
-  char  **TestIteration,
-  char  **TestConfigFile,
-  char  **TestOutpath
+  int       argc,
+  char      *argv[],
+  char      **TestIteration,
+  char      **TestConfigFile,
+  char      **TestOutpath,
+  char      **TestFilter,
+  bool      *ForkIterations,
+  bool      *WorkerMode,
+  uint32_t  *WatchdogTimeout
   )
 {
   int32_t Index;
-  if (argc<7) {
-    printf ("Insufficient command line arguments.\n");
-    UtUsage (argv[0]);
-    exit (AMD_UNIT_TEST_ABORTED);
-  }
+  char    *End;
   for (Index=1; Index < argc; Index++) {
+    if ((Index + 1 == argc) && (!strcmp(argv[Index], "-o") || !strcmp(argv[Index], "-i") ||
+      !strcmp(argv[Index], "-c") || !strcmp(argv[Index], "-t") || !strcmp(argv[Index], "-w"))) {
+      printf ("Missing value of command line argument %s.\n", argv[Index]);
+      UtUsage (argv[0]);
+      exit (AMD_UNIT_TEST_ABORTED);
+    }
     if (!strcmp(argv[Index], "-o")) {
       *TestOutpath = argv[++Index];
     } else if (!strcmp(argv[Index], "-i")) {
       *TestIteration = argv[++Index];
     } else if (!strcmp(argv[Index], "-c")) {
       *TestConfigFile = argv[++Index];
+    } else if (!strcmp(argv[Index], "-t")) {
+      *TestFilter = argv[++Index];
+    } else if (!strcmp(argv[Index], "-w")) {
+      *WatchdogTimeout = (uint32_t) strtoul (argv[++Index], &End, 10);
+      if ((End == argv[Index]) || (*End != '\0')) {
+        printf ("Invalid value of command line argument -w (i.e., %s).\n", argv[Index]);
+        UtUsage (argv[0]);
+        exit (AMD_UNIT_TEST_ABORTED);
+      }
+    } else if (!strcmp(argv[Index], "-f")) {
+      *ForkIterations = true;
+    } else if (!strcmp(argv[Index], "--worker")) {
+      *WorkerMode = true;
     } else if (!strcmp(argv[Index], "?") || !strcmp(argv[Index], "-h") ||
       !strcmp(argv[Index], "/?") || !strcmp(argv[Index], "--help")) {
       UtUsage (argv[0]);
@@ -289,106 +481,574 @@ UtParseArgs (
       exit (AMD_UNIT_TEST_ABORTED);
     }
   }
+  if ((*TestConfigFile == NULL) ||
+      (!*WorkerMode && ((*TestIteration == NULL) || (*TestOutpath == NULL)))) {
+    printf ("Insufficient command line arguments.\n");
+    UtUsage (argv[0]);
+    exit (AMD_UNIT_TEST_ABORTED);
+  }
   return AMD_UNIT_TEST_PASSED;
 }
 
-int
-AmdTestSetupFunctionRunner (
-  void  **state
+static
+void
+UtRunResetHandlers (
+  void
   )
 {
-  AMD_UNIT_TEST_WRAPPER *UnitTest;
-  UnitTest = (AMD_UNIT_TEST_WRAPPER *)(*state);
-  if (UnitTest->PrereqFunc == NULL) {
-    return AMD_UNIT_TEST_PASSED;
+  uint32_t Index;
+
+  for (Index = 0; Index < ResetHandlerCount; Index++) {
+    ResetHandlers[Index] ();
   }
-  return UnitTest->PrereqFunc (UnitTest->Context);
 }
 
+/**
+ * UtEndIteration
+ * @brief Writes the result file of the current iteration and closes its log.
+ *
+ * @param Ut  Test framework
+ */
+static
 void
-AmdTestFunctionRunner (
-  void  **state
+UtEndIteration (
+  AMD_UNIT_TEST_FRAMEWORK *Ut
   )
 {
-  AMD_UNIT_TEST_WRAPPER *UnitTest;
-  UnitTest = (AMD_UNIT_TEST_WRAPPER *)(*state);
-  if (UnitTest->TestFunc != NULL) {
-    UnitTest->TestFunc (UnitTest->Context);
+  if (Ut->ResultFile != NULL) {
+    UtAddElementToResult (Ut, "Status", UtGetTestStatusString (Ut));
+    UtWrite2ResultFile (Ut);
+    fclose (Ut->ResultFile);
+    cJSON_Delete(Ut->TestResultRoot);
+    Ut->ResultFile = NULL;
+    Ut->TestResultRoot = NULL;
+  }
+  if (Ut->LogFile != NULL) {
+    Ut->Log(AMD_UNIT_TEST_LOG_INFO, __FUNCTION__, __LINE__, "Final Test Status was %s.", UtGetTestStatusString (Ut));
+    log_remove_fp (Ut->LogFile);
+    fclose (Ut->LogFile);
+    Ut->LogFile = NULL;
   }
 }
 
-int
-AmdTestTeardownFunctionRunner (
-  void  **state
+/**
+ * UtSelectIteration
+ * @brief Makes an iteration of TestIterations the current one.
+ *
+ * @details The test status starts over. When several iterations run, the
+ *          iteration gets its own log and result file in a sub-directory of
+ *          the output directory named after it.
+ *
+ * @param Ut     Test framework
+ * @param Index  Index in TestIterations
+ *
+ * @retval AMD_UNIT_TEST_PASSED   Iteration selected
+ * @retval AMD_UNIT_TEST_ABORTED  Its output files cannot be created
+ */
+static
+AMD_UNIT_TEST_STATUS
+UtSelectIteration (
+  AMD_UNIT_TEST_FRAMEWORK *Ut,
+  uint32_t                Index
   )
 {
-  AMD_UNIT_TEST_WRAPPER *UnitTest;
-  UnitTest = (AMD_UNIT_TEST_WRAPPER *)(*state);
-  if (UnitTest->CleanUpFunc != NULL) {
-    return UnitTest->CleanUpFunc (UnitTest->Context);
+  AMD_UNIT_TEST_STATUS Status;
+
+  Ut->TestIterationIndex  = Index;
+  Ut->TestConfigIteration = Ut->TestIterations[Index];
+  Ut->TestStatus          = AMD_UNIT_TEST_STATUS_NOT_SET;
+  if (Ut->TestOutputRoot == NULL) {
+    return AMD_UNIT_TEST_PASSED;
+  }
+
+  Ut->TestIteration = (char*) UtGetIterationName (Ut->TestConfigIteration);
+  if (strlen(Ut->TestOutputRoot)+strlen(Ut->TestIteration)+1 >= AMD_UNIT_TEST_MAX_PATH_LENGTH) {
+    Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+      "Output directory of iteration '%s' exceeds the maximum path length allowed (%d).",
+      Ut->TestIteration, AMD_UNIT_TEST_MAX_PATH_LENGTH);
+    return AMD_UNIT_TEST_ABORTED;
+  }
+  strcpy_s (Ut->TestOutpath, AMD_UNIT_TEST_MAX_PATH_LENGTH, Ut->TestOutputRoot);
+  strcat_s (Ut->TestOutpath, AMD_UNIT_TEST_MAX_PATH_LENGTH, UT_PATH_SEPARATOR);
+  strcat_s (Ut->TestOutpath, AMD_UNIT_TEST_MAX_PATH_LENGTH, Ut->TestIteration);
+  UtMakeDirectory (Ut->TestOutpath);
+
+  Status = UtInitTestLogger (Ut);
+  if (Status != AMD_UNIT_TEST_PASSED) {
+    return Status;
+  }
+  Status = UtInitTestResult (Ut);
+  if (Status != AMD_UNIT_TEST_PASSED) {
+    return Status;
   }
+  Ut->Log(AMD_UNIT_TEST_LOG_INFO, __FUNCTION__, __LINE__,
+    "Iteration %s (%u of %u) started.", Ut->TestIteration, Index + 1, Ut->TestIterationCount);
   return AMD_UNIT_TEST_PASSED;
 }
 
-AMD_UNIT_TEST_FRAMEWORK_HANDLE
-UtGetActiveFrameworkHandle (
-  void
+/**
+ * UtFormatDecimal
+ * @brief Writes a number in decimal without the C library, for UtWatchdogExpired.
+ *
+ * @param Buffer  Room for 20 characters
+ * @param Value   Number
+ *
+ * @return Number of characters written; no terminator is added.
+ */
+static
+size_t
+UtFormatDecimal (
+  char      *Buffer,
+  uint64_t  Value
   )
 {
-  return ActiveFramework;
-}
+  char    Digits[20];
+  size_t  Count;
+  size_t  Index;
 
-uint32_t
-UtGetTestStatus (
-  AMD_UNIT_TEST_FRAMEWORK *Ut
-  )
-{
-  return Ut->TestStatus;
+  Count = 0;
+  do {
+    Digits[Count++] = (char) ('0' + Value % 10);
+    Value /= 10;
+  } while (Value != 0);
+  for (Index = 0; Index < Count; Index++) {
+    Buffer[Index] = Digits[Count - 1 - Index];
+  }
+  return Count;
 }
 
-const char *
-UtGetTestStatusString (
-  AMD_UNIT_TEST_FRAMEWORK *Ut
+/**
+ * UtAppendTimeoutResult
+ * @brief Appends printed elements to the result UtWatchdogExpired writes.
+ *
+ * @details The result in use is appended to in place when it has room: the
+ *          watchdog sees the new characters once its length is updated.
+ *          Otherwise it is copied with the new characters to the other one,
+ *          grown to twice the size, which is then put in use.
+ *
+ * @param Text    Printed elements
+ * @param Length  Characters of Text
+ */
+static
+void
+UtAppendTimeoutResult (
+  const char  *Text,
+  size_t      Length
   )
 {
-  if (Ut->TestStatus == AMD_UNIT_TEST_PASSED) {
-    return "PASSED";
-  } else if (Ut->TestStatus == AMD_UNIT_TEST_FAILED) {
-    return "FAILED";
-  } else if (Ut->TestStatus == AMD_UNIT_TEST_ABORTED) {
-    return "ABORTED";
-  } else {
-    return "NOT_SET";
+  UT_TIMEOUT_RESULT *Result;
+  UT_TIMEOUT_RESULT *Spare;
+  size_t            Capacity;
+
+  Result = &TimeoutReport.Results[TimeoutReport.Result];
+  if (Result->Length + Length <= Result->Capacity) {
+    memcpy (Result->Text + Result->Length, Text, Length);
+    UtWatchdogFence ();
+    Result->Length += Length;
+    return;
+  }
+
+  Spare = &TimeoutReport.Results[1 - TimeoutReport.Result];
+  free (Spare->Text);
+  Capacity = 2 * (Result->Length + Length);
+  if (Capacity < UT_TIMEOUT_RESULT_MIN_CAPACITY) {
+    Capacity = UT_TIMEOUT_RESULT_MIN_CAPACITY;
+  }
+  Spare->Text     = (char*) malloc (Capacity);
+  Spare->Length   = 0;
+  Spare->Capacity = 0;
+  if (Spare->Text == NULL) {
+    return;
   }
+  if (Result->Length > 0) {
+    memcpy (Spare->Text, Result->Text, Result->Length);
+  }
+  memcpy (Spare->Text + Result->Length, Text, Length);
+  Spare->Length   = Result->Length + Length;
+  Spare->Capacity = Capacity;
+  UtWatchdogFence ();
+  TimeoutReport.Result = 1 - TimeoutReport.Result;
 }
 
-const char *
-UtGetTestName (
+/**
+ * UtPrepareTimeoutResult
+ * @brief Prints the result of the current iteration, to which UtWatchdogExpired adds the timeout elements.
+ *
+ * @details The result is printed once, when the watchdog is armed;
+ *          UtAddElementToResult then appends each element added.
+ *
+ * @param Ut  Test framework
+ */
+static
+void
+UtPrepareTimeoutResult (
   AMD_UNIT_TEST_FRAMEWORK *Ut
   )
 {
-  return Ut->TestName;
+  char    *Text;
+  size_t  Length;
+
+  if (Ut->ResultFile == NULL) {
+    return;
+  }
+  Text = cJSON_Print (Ut->TestResultRoot);
+  if (Text == NULL) {
+    return;
+  }
+  //
+  // The closing brace, and the line break before it, follow the last element.
+  //
+  Length = strlen (Text);
+  UtAppendTimeoutResult (Text, (Length >= 2) ? Length - 2 : 0);
+  cJSON_free (Text);
 }
 
-const char *
-UtGetTestIteration (
-  AMD_UNIT_TEST_FRAMEWORK *Ut
+/**
+ * UtWriteTimeoutMessage
+ * @brief Writes the timeout message of UtWatchdogExpired to a log.
+ *
+ * @param File              Log
+ * @param Prefix            Time and level of the message
+ * @param Elapsed           Elapsed time
+ * @param ElapsedLength     Length of Elapsed
+ * @param TracePoint        Last trace point
+ * @param TracePointLength  Length of TracePoint
+ */
+static
+void
+UtWriteTimeoutMessage (
+  UT_WATCHDOG_FILE  File,
+  const char        *Prefix,
+  const char        *Elapsed,
+  size_t            ElapsedLength,
+  const char        *TracePoint,
+  size_t            TracePointLength
   )
 {
-  return Ut->TestIteration;
+  static const char Status[] = ". Test status was set to TIMEOUT.\n";
+
+  UtWatchdogWrite (File, Prefix, strlen (Prefix));
+  UtWatchdogWrite (File, TimeoutReport.Message, strlen (TimeoutReport.Message));
+  UtWatchdogWrite (File, Elapsed, ElapsedLength);
+  UtWatchdogWrite (File, TimeoutReport.Timeout, strlen (TimeoutReport.Timeout));
+  UtWatchdogWrite (File, TracePoint, TracePointLength);
+  UtWatchdogWrite (File, Status, sizeof (Status) - 1);
 }
 
+/**
+ * UtWatchdogExpired
+ * @brief Ends the test process when the current iteration runs past its timeout (-w).
+ *
+ * @details Runs while the iteration is stopped, possibly in the middle of a
+ *          library call, see UtWatchdogStart: it only writes what
+ *          UtArmWatchdog prepared, with UtWatchdogWrite. The iteration result
+ *          is written with status TIMEOUT, the elapsed time and the last
+ *          trace point logged (function and line of the last SIL trace or
+ *          framework log message), and the timeout is logged. A worker
+ *          answers the request it was running. The process then exits with
+ *          AMD_UNIT_TEST_TIMEOUT without running the exit handlers, so the
+ *          gcov and llvm-cov coverage of the process is not written; the
+ *          remaining iterations of the process are not run. A forked
+ *          iteration only ends its child process, and the test process goes
+ *          on with the next iteration.
+ *
+ * @param ElapsedMs  Time since the iteration started
+ */
+static
 void
-UtSetTestStatus (
-  AMD_UNIT_TEST_FRAMEWORK *Ut,
-  AMD_UNIT_TEST_STATUS    Status
+UtWatchdogExpired (
+  uint64_t  ElapsedMs
   )
 {
-  if (Ut->TestStatus == AMD_UNIT_TEST_STATUS_NOT_SET) {
-    Ut->TestStatus = Status;
-  } else if (Ut->TestStatus < Status) {
-    Ut->TestStatus = Status;
-  } else {
+  static const char ElapsedKey[]    = "\n\t\"Elapsed\":\t\"";
+  static const char TracePointKey[] = "\",\n\t\"LastTracePoint\":\t\"";
+  static const char StatusKey[]     = "\",\n\t\"Status\":\t\"TIMEOUT\"\n}";
+  UT_TIMEOUT_RESULT *Result;
+  const char        *TraceFunction;
+  int               TraceLine;
+  char              Elapsed[32];
+  char              TracePoint[AMD_UNIT_TEST_MAX_FILENAME_LENGTH];
+  size_t            ElapsedLength;
+  size_t            TracePointLength;
+  size_t            Index;
+  char              Character;
+
+  ElapsedLength = UtFormatDecimal (Elapsed, ElapsedMs / 1000);
+  Elapsed[ElapsedLength++] = '.';
+  Elapsed[ElapsedLength++] = (char) ('0' + (ElapsedMs / 100) % 10);
+  Elapsed[ElapsedLength++] = (char) ('0' + (ElapsedMs / 10) % 10);
+  Elapsed[ElapsedLength++] = (char) ('0' + ElapsedMs % 10);
+
+  //
+  // Only the characters of a C identifier are kept from the function name,
+  // so that the trace point needs no escaping in the result.
+  //
+  log_last_location (&TraceFunction, &TraceLine);
+  TracePointLength = 0;
+  if (TraceFunction != NULL) {
+    for (Index = 0; (TraceFunction[Index] != '\0') && (TracePointLength < sizeof (TracePoint) - 22); Index++) {
+      Character = TraceFunction[Index];
+      if (((Character >= 'a') && (Character <= 'z')) || ((Character >= 'A') && (Character <= 'Z')) ||
+          ((Character >= '0') && (Character <= '9')) || (Character == '_')) {
+        TracePoint[TracePointLength++] = Character;
+      }
+    }
+    TracePoint[TracePointLength++] = ':';
+    TracePointLength += UtFormatDecimal (&TracePoint[TracePointLength], (TraceLine > 0) ? (uint64_t) TraceLine : 0);
+  } else {
+    memcpy (TracePoint, "NA", 2);
+    TracePointLength = 2;
+  }
+
+  UtWriteTimeoutMessage (TimeoutReport.ErrorFile, TimeoutReport.ErrorPrefix, Elapsed, ElapsedLength, TracePoint,
+    TracePointLength);
+  UtWriteTimeoutMessage (TimeoutReport.LogFile, TimeoutReport.LogPrefix, Elapsed, ElapsedLength, TracePoint,
+    TracePointLength);
+  UtWriteTimeoutMessage (TimeoutReport.SessionLogFile, TimeoutReport.LogPrefix, Elapsed, ElapsedLength, TracePoint,
+    TracePointLength);
+
+  //
+  // The timeout elements follow the ones printed, as cJSON_Print lays them out.
+  //
+  Result = &TimeoutReport.Results[TimeoutReport.Result];
+  if (Result->Length > 0) {
+    UtWatchdogWrite (TimeoutReport.ResultFile, Result->Text, Result->Length);
+    UtWatchdogWrite (TimeoutReport.ResultFile, ",", (Result->Length > 1) ? 1 : 0);
+    UtWatchdogWrite (TimeoutReport.ResultFile, ElapsedKey, sizeof (ElapsedKey) - 1);
+    UtWatchdogWrite (TimeoutReport.ResultFile, Elapsed, ElapsedLength);
+    UtWatchdogWrite (TimeoutReport.ResultFile, TracePointKey, sizeof (TracePointKey) - 1);
+    UtWatchdogWrite (TimeoutReport.ResultFile, TracePoint, TracePointLength);
+    UtWatchdogWrite (TimeoutReport.ResultFile, StatusKey, sizeof (StatusKey) - 1);
+  }
+
+  if (!ForkedIteration && (TimeoutReport.WorkerResponse != NULL)) {
+    UtWatchdogWrite (TimeoutReport.WorkerFile, TimeoutReport.WorkerResponse, strlen (TimeoutReport.WorkerResponse));
+    UtWatchdogWrite (TimeoutReport.WorkerFile, "\n", 1);
+  }
+  UtWatchdogExit (AMD_UNIT_TEST_TIMEOUT);
+}
+
+/**
+ * UtDisarmWatchdog
+ * @brief Stops the watchdog of the current iteration and frees its timeout report.
+ */
+static
+void
+UtDisarmWatchdog (
+  void
+  )
+{
+  uint32_t Index;
+
+  if (!TimeoutReport.Armed) {
+    return;
+  }
+  UtWatchdogStop ();
+  TimeoutReport.Armed = false;
+  for (Index = 0; Index < 2; Index++) {
+    free (TimeoutReport.Results[Index].Text);
+    TimeoutReport.Results[Index].Text     = NULL;
+    TimeoutReport.Results[Index].Length   = 0;
+    TimeoutReport.Results[Index].Capacity = 0;
+  }
+}
+
+/**
+ * UtArmWatchdog
+ * @brief Prepares the timeout report of the current iteration and starts its watchdog (-w).
+ *
+ * @details The messages are dated with the time the watchdog expires.
+ *
+ * @param Ut  Test framework
+ */
+static
+void
+UtArmWatchdog (
+  AMD_UNIT_TEST_FRAMEWORK *Ut
+  )
+{
+  time_t    Expiry;
+  struct tm Time;
+  char      Date[32];
+  int       Line;
+
+  if (Ut->WatchdogTimeout == 0) {
+    return;
+  }
+  Line   = __LINE__;
+  Expiry = time (NULL) + Ut->WatchdogTimeout;
+  memset (&Time, 0, sizeof (Time));
+  localtime_s (&Time, &Expiry);
+  strftime (Date, sizeof (Date), "%Y-%m-%d %H:%M:%S", &Time);
+  snprintf (TimeoutReport.LogPrefix, sizeof (TimeoutReport.LogPrefix), "%s %-5s %s:%d: ",
+    Date, log_level_string (AMD_UNIT_TEST_LOG_ERROR), __FUNCTION__, Line);
+  strftime (Date, sizeof (Date), "%H:%M:%S", &Time);
+  snprintf (TimeoutReport.ErrorPrefix, sizeof (TimeoutReport.ErrorPrefix), "%s %-5s %s:%d: ",
+    Date, log_level_string (AMD_UNIT_TEST_LOG_ERROR), __FUNCTION__, Line);
+  snprintf (TimeoutReport.Message, sizeof (TimeoutReport.Message), "Iteration %s timed out after ",
+    (Ut->TestIteration != NULL) ? Ut->TestIteration : "NA");
+  snprintf (TimeoutReport.Timeout, sizeof (TimeoutReport.Timeout), " s (timeout: %u s). Last trace point: ",
+    Ut->WatchdogTimeout);
+  TimeoutReport.ResultFile     = UtWatchdogFile (Ut->ResultFile);
+  TimeoutReport.LogFile        = UtWatchdogFile (Ut->LogFile);
+  TimeoutReport.SessionLogFile = UtWatchdogFile (Ut->SessionLogFile);
+  TimeoutReport.ErrorFile      = UtWatchdogFile (stderr);
+  UtPrepareTimeoutResult (Ut);
+  TimeoutReport.Armed = true;
+
+  if (!UtWatchdogStart (Ut->WatchdogTimeout, UtWatchdogExpired)) {
+    Ut->Log(AMD_UNIT_TEST_LOG_WARN, __FUNCTION__, __LINE__,
+      "Failed to start the watchdog. Iteration %s runs without timeout.", Ut->TestIteration);
+    UtDisarmWatchdog ();
+  }
+}
+
+int
+AmdTestSetupFunctionRunner (
+  void  **state
+  )
+{
+  AMD_UNIT_TEST_WRAPPER   *UnitTest;
+  AMD_UNIT_TEST_FRAMEWORK *Ut;
+  AMD_UNIT_TEST_STATUS    Status;
+  uint32_t                Index;
+  UnitTest = (AMD_UNIT_TEST_WRAPPER *)(*state);
+  Ut = (AMD_UNIT_TEST_FRAMEWORK*) ActiveFramework;
+
+  //
+  // Iterations after the first start from a reset platform and framework.
+  //
+  if (UnitTest->IterationIndex != Ut->TestIterationIndex) {
+    IterationActive = false;
+    UtRunResetHandlers ();
+    UtEndIteration (Ut);
+    Status = UtSelectIteration (Ut, UnitTest->IterationIndex);
+    if (Status != AMD_UNIT_TEST_PASSED) {
+      return Status;
+    }
+  }
+
+  //
+  // The watchdog covers the iteration from its setup to the end of its clean up.
+  //
+  UtArmWatchdog (Ut);
+
+  IterationActive  = true;
+  TestBodyReturned = false;
+  for (Index = 0; Index < SetupHandlerCount; Index++) {
+    SetupHandlers[Index] (Ut);
+  }
+  if (UnitTest->PrereqFunc == NULL) {
+    return AMD_UNIT_TEST_PASSED;
+  }
+  Status = UnitTest->PrereqFunc (UnitTest->Context);
+  if (Status != AMD_UNIT_TEST_PASSED) {
+    Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+      "TestPrerequisite returned a non-zero value (%d). Test status was set to ABORTED.", Status);
+    UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
+    // cmocka does not tear down a test whose setup failed.
+    UtDisarmWatchdog ();
+  }
+  return Status;
+}
+
+void
+AmdTestFunctionRunner (
+  void  **state
+  )
+{
+  AMD_UNIT_TEST_WRAPPER *UnitTest;
+  UnitTest = (AMD_UNIT_TEST_WRAPPER *)(*state);
+  if (UnitTest->TestFunc != NULL) {
+    UnitTest->TestFunc (UnitTest->Context);
+  }
+  TestBodyReturned = true;
+}
+
+int
+AmdTestTeardownFunctionRunner (
+  void  **state
+  )
+{
+  AMD_UNIT_TEST_WRAPPER   *UnitTest;
+  AMD_UNIT_TEST_FRAMEWORK *Ut;
+  AMD_UNIT_TEST_STATUS    Status;
+  UnitTest = (AMD_UNIT_TEST_WRAPPER *)(*state);
+  Ut = (AMD_UNIT_TEST_FRAMEWORK*) ActiveFramework;
+  if (!TestBodyReturned) {
+    Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+      "TestBody failed a cmocka check. Test status was set to ABORTED.");
+    UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
+  }
+  Status = AMD_UNIT_TEST_PASSED;
+  if (UnitTest->CleanUpFunc != NULL) {
+    Status = UnitTest->CleanUpFunc (UnitTest->Context);
+  }
+  UtDisarmWatchdog ();
+  return Status;
+}
+
+AMD_UNIT_TEST_FRAMEWORK_HANDLE
+UtGetActiveFrameworkHandle (
+  void
+  )
+{
+  return ActiveFramework;
+}
+
+uint32_t
+UtGetTestStatus (
+  AMD_UNIT_TEST_FRAMEWORK *Ut
+  )
+{
+  return Ut->TestStatus;
+}
+
+const char *
+UtGetTestStatusString (
+  AMD_UNIT_TEST_FRAMEWORK *Ut
+  )
+{
+  if (Ut->TestStatus == AMD_UNIT_TEST_PASSED) {
+    return "PASSED";
+  } else if (Ut->TestStatus == AMD_UNIT_TEST_FAILED) {
+    return "FAILED";
+  } else if (Ut->TestStatus == AMD_UNIT_TEST_ABORTED) {
+    return "ABORTED";
+  } else if (Ut->TestStatus == AMD_UNIT_TEST_TIMEOUT) {
+    return "TIMEOUT";
+  } else {
+    return "NOT_SET";
+  }
+}
+
+const char *
+UtGetTestName (
+  AMD_UNIT_TEST_FRAMEWORK *Ut
+  )
+{
+  return Ut->TestName;
+}
+
+const char *
+UtGetTestIteration (
+  AMD_UNIT_TEST_FRAMEWORK *Ut
+  )
+{
+  return Ut->TestIteration;
+}
+
+void
+UtSetTestStatus (
+  AMD_UNIT_TEST_FRAMEWORK *Ut,
+  AMD_UNIT_TEST_STATUS    Status
+  )
+{
+  if (Ut->TestStatus == AMD_UNIT_TEST_STATUS_NOT_SET) {
+    Ut->TestStatus = Status;
+  } else if (Ut->TestStatus < Status) {
+    Ut->TestStatus = Status;
+  } else {
     ;
   }
 }
@@ -400,67 +1060,169 @@ UtAddElementToResult (
   const char              *Value
   )
 {
+  cJSON   *Element;
+  char    *Text;
+  size_t  Length;
+
   cJSON_AddStringToObject(Ut->TestResultRoot, Key, Value);
+  if (!TimeoutReport.Armed || (TimeoutReport.Results[TimeoutReport.Result].Length == 0)) {
+    return;
+  }
+
+  //
+  // Only the element is printed, as an object of its own, and appended to the
+  // result printed so far: its braces give way to the separator.
+  //
+  Text    = NULL;
+  Element = cJSON_CreateObject ();
+  if ((Element != NULL) && (cJSON_AddStringToObject (Element, Key, Value) != NULL)) {
+    Text = cJSON_Print (Element);
+  }
+  cJSON_Delete (Element);
+  if (Text == NULL) {
+    return;
+  }
+  Length = strlen (Text) - 2;
+  if (TimeoutReport.Results[TimeoutReport.Result].Length > 1) {
+    Text[0] = ',';
+    UtAppendTimeoutResult (Text, Length);
+  } else {
+    UtAppendTimeoutResult (Text + 1, Length - 1);
+  }
+  cJSON_free (Text);
 }
 
+/**
+ * UtInit
+ * @brief Opens the output files and the test configuration of a test.
+ *
+ * @details TestName, TestIteration, TestConfigFile and TestOutpath must be set.
+ *          On failure the framework is deinitialized.
+ *
+ * @param Ut  Test framework
+ *
+ * @retval AMD_UNIT_TEST_PASSED   Framework ready to run the test
+ * @retval NON-ZERO               Initialization failed
+ */
+static
 AMD_UNIT_TEST_STATUS
-UtInitFromArgs (
-  AMD_UNIT_TEST_FRAMEWORK *Ut,
-  int  argc,
-  char *argv[]
+UtInit (
+  AMD_UNIT_TEST_FRAMEWORK *Ut
   )
 {
   AMD_UNIT_TEST_STATUS Status;
 
-  memset ((void*)Ut, 0x00, sizeof(AMD_UNIT_TEST_FRAMEWORK));
-  UtSetTestStatus (Ut, AMD_UNIT_TEST_STATUS_NOT_SET);
+  //
+  // Several iterations: the log of the whole run goes to the output
+  // directory, each iteration writes to its own sub-directory.
+  //
+  if ((strcmp (Ut->TestIteration, AMD_UNIT_TEST_ALL_ITERATIONS) == 0) ||
+      (strchr (Ut->TestIteration, AMD_UNIT_TEST_ITERATION_SEPARATOR) != NULL)) {
+    Ut->TestOutputRoot = Ut->TestOutpath;
+    Ut->TestOutpath    = (char*) malloc (AMD_UNIT_TEST_MAX_PATH_LENGTH);
+    if (Ut->TestOutpath == NULL) {
+      printf ("UtInitFromArgs failed to allocate memory dynamically.\n");
+      Ut->TestOutpath    = Ut->TestOutputRoot;
+      Ut->TestOutputRoot = NULL;
+      UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
+      UtDeinit (Ut);
+      return AMD_UNIT_TEST_ABORTED;
+    }
+    strcpy_s (Ut->TestOutpath, AMD_UNIT_TEST_MAX_PATH_LENGTH, Ut->TestOutputRoot);
+  }
 
-  Status = UtParseArgs (argc, argv, &Ut->TestIteration, &Ut->TestConfigFile, &Ut->TestOutpath);
+  Status = UtInitTestLogger (Ut);
   if (Status != AMD_UNIT_TEST_PASSED) {
-    printf ("UtParseArgs failed (Status=0x%x).\n", Status);
+    printf ("UtInitTestLogger failed (Status=0x%x).\n", Status);
     UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
     UtDeinit (Ut);
     return Status;
   }
 
-  Status = UtSetTestNameFromArgs (Ut, argc, argv);
+  if (Ut->TestOutputRoot != NULL) {
+    Ut->SessionLogFile = Ut->LogFile;
+    Ut->LogFile        = NULL;
+  } else {
+    Status = UtInitTestResult (Ut);
+  }
   if (Status != AMD_UNIT_TEST_PASSED) {
-    printf ("UtSetTestName failed (Status=0x%x).\n", Status);
+    printf ("UtInitTestResult failed (Status=0x%x).\n", Status);
     UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
+    Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+      "UtInitTestResult returned a non-zero value (%d). Test status was set to ABORTED.", Status);
     UtDeinit (Ut);
     return Status;
   }
 
-  Status = UtInitTestLogger (Ut);
+  Status = UtInitTestConfigs (Ut);
   if (Status != AMD_UNIT_TEST_PASSED) {
-    printf ("UtInitTestLogger failed (Status=0x%x).\n", Status);
     UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
+    Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+      "UtInitTestConfigs returned a non-zero value (%d). Test status was set to ABORTED.", Status);
     UtDeinit (Ut);
     return Status;
   }
 
-  Status = UtInitTestResult (Ut);
+  Status = UtSelectIteration (Ut, 0);
   if (Status != AMD_UNIT_TEST_PASSED) {
-    printf ("UtInitTestResult failed (Status=0x%x).\n", Status);
     UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
     Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
-      "UtInitTestResult returned a non-zero value (%d). Test status was set to ABORTED.", Status);
+      "UtSelectIteration returned a non-zero value (%d). Test status was set to ABORTED.", Status);
     UtDeinit (Ut);
     return Status;
   }
 
-  Status = UtInitTestConfigs (Ut);
+  UtSetActiveFrameworkHandle ((AMD_UNIT_TEST_FRAMEWORK_HANDLE)Ut);
+
+  return AMD_UNIT_TEST_PASSED;
+}
+
+AMD_UNIT_TEST_STATUS
+UtInitFromArgs (
+  AMD_UNIT_TEST_FRAMEWORK *Ut,
+  int  argc,
+  char *argv[]
+  )
+{
+  AMD_UNIT_TEST_STATUS Status;
+  char                 *TestFilter;
+
+  memset ((void*)Ut, 0x00, sizeof(AMD_UNIT_TEST_FRAMEWORK));
+  UtSetTestStatus (Ut, AMD_UNIT_TEST_STATUS_NOT_SET);
+
+  TestFilter = NULL;
+  Status = UtParseArgs (argc, argv, &Ut->TestIteration, &Ut->TestConfigFile, &Ut->TestOutpath, &TestFilter,
+             &Ut->ForkIterations, &Ut->WorkerMode, &Ut->WatchdogTimeout);
   if (Status != AMD_UNIT_TEST_PASSED) {
+    printf ("UtParseArgs failed (Status=0x%x).\n", Status);
     UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
-    Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
-      "UtInitTestConfigs returned a non-zero value (%d). Test status was set to ABORTED.", Status);
     UtDeinit (Ut);
     return Status;
   }
+  if (TestFilter != NULL) {
+    printf ("-t is only supported by test table binaries.\n");
+    UtUsage (argv[0]);
+    exit (AMD_UNIT_TEST_ABORTED);
+  }
 
-  UtSetActiveFrameworkHandle ((AMD_UNIT_TEST_FRAMEWORK_HANDLE)Ut);
+  Status = UtSetTestNameFromArgs (Ut, argc, argv);
+  if (Status != AMD_UNIT_TEST_PASSED) {
+    printf ("UtSetTestName failed (Status=0x%x).\n", Status);
+    UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
+    UtDeinit (Ut);
+    return Status;
+  }
 
-  return AMD_UNIT_TEST_PASSED;
+  //
+  // A worker initializes a framework per request, see UtServeRequests.
+  //
+  if (Ut->WorkerMode) {
+    Ut->Log = log_log;
+    UtSetActiveFrameworkHandle ((AMD_UNIT_TEST_FRAMEWORK_HANDLE)Ut);
+    return AMD_UNIT_TEST_PASSED;
+  }
+
+  return UtInit (Ut);
 }
 
 void
@@ -472,43 +1234,825 @@ UtSetTestContext (
   Ut->TestContext = Context;
 }
 
+/**
+ * UtRegisterResetHandler
+ * @brief Registers a function that returns a fake's state to power-on defaults.
+ *
+ * @details Reset handlers are called by UtRunTest once the iteration's clean up
+ *          has run, so the next iteration starts from a clean platform.
+ *          Registering the same handler twice has no effect.
+ *
+ * @param Handler  Reset function
+ *
+ * @retval AMD_UNIT_TEST_PASSED   Handler registered
+ * @retval AMD_UNIT_TEST_ABORTED  Too many handlers
+ */
+AMD_UNIT_TEST_STATUS
+UtRegisterResetHandler (
+  AMD_UNIT_TEST_RESET_HANDLER Handler
+  )
+{
+  uint32_t Index;
+
+  for (Index = 0; Index < ResetHandlerCount; Index++) {
+    if (ResetHandlers[Index] == Handler) {
+      return AMD_UNIT_TEST_PASSED;
+    }
+  }
+  if (ResetHandlerCount >= AMD_UNIT_TEST_MAX_RESET_HANDLERS) {
+    return AMD_UNIT_TEST_ABORTED;
+  }
+  ResetHandlers[ResetHandlerCount++] = Handler;
+  return AMD_UNIT_TEST_PASSED;
+}
+
+/**
+ * UtRegisterSetupHandler
+ * @brief Registers a function that prepares a fake from the iteration's configuration.
+ *
+ * @details Setup handlers are called before TestPrerequisite of every
+ *          iteration. A handler registered while an iteration is running
+ *          (e.g. by a fake initialized lazily from TestPrerequisite) is
+ *          called right away for that iteration.
+ *          Registering the same handler twice has no effect.
+ *
+ * @param Handler  Setup function
+ *
+ * @retval AMD_UNIT_TEST_PASSED   Handler registered
+ * @retval AMD_UNIT_TEST_ABORTED  Too many handlers
+ */
+AMD_UNIT_TEST_STATUS
+UtRegisterSetupHandler (
+  AMD_UNIT_TEST_SETUP_HANDLER Handler
+  )
+{
+  uint32_t Index;
+
+  for (Index = 0; Index < SetupHandlerCount; Index++) {
+    if (SetupHandlers[Index] == Handler) {
+      return AMD_UNIT_TEST_PASSED;
+    }
+  }
+  if (SetupHandlerCount >= AMD_UNIT_TEST_MAX_SETUP_HANDLERS) {
+    return AMD_UNIT_TEST_ABORTED;
+  }
+  SetupHandlers[SetupHandlerCount++] = Handler;
+  if (IterationActive && (ActiveFramework != NULL)) {
+    Handler ((AMD_UNIT_TEST_FRAMEWORK*) ActiveFramework);
+  }
+  return AMD_UNIT_TEST_PASSED;
+}
+
+/**
+ * UtRunIterations
+ * @brief Runs cmocka tests of iterations in this process.
+ *
+ * @param Ut         Test framework
+ * @param Tests      One cmocka test per iteration
+ * @param TestCount  Number of tests
+ *
+ * @return cmocka return code
+ */
+static
 int
-UtRunTest (
+UtRunIterations (
+  AMD_UNIT_TEST_FRAMEWORK   *Ut,
+  const struct CMUnitTest   *Tests,
+  uint32_t                  TestCount
+  )
+{
+  int ReturnCode;
+
+  ReturnCode = _cmocka_run_group_tests(Ut->TestName, Tests, TestCount, NULL, NULL);
+  if (ReturnCode != 0) {
+    Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+      "UtRunTest returned a non-zero value (%d). Test status was set to ABORTED.", ReturnCode);
+    if (Ut->TestOutputRoot == NULL) {
+      UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
+    }
+  }
+  return ReturnCode;
+}
+
+#if defined(_WIN32)
+
+static
+int
+UtRunForkedIterations (
+  AMD_UNIT_TEST_FRAMEWORK   *Ut,
+  const struct CMUnitTest   *Tests
+  )
+{
+  Ut->Log(AMD_UNIT_TEST_LOG_WARN, __FUNCTION__, __LINE__,
+    "Fork-server mode is not supported on this host. Iterations run in the test process.");
+  return UtRunIterations (Ut, Tests, Ut->TestIterationCount);
+}
+
+#else
+
+#define FORKED_ITERATION_STATUS_MASK      0x0F
+#define FORKED_ITERATION_CMOCKA_FAILURE   0x10
+
+//
+// Compiler coverage is written by exit handlers, which a forked iteration
+// skips (see UT_COVERAGE in AgesaModuleUtPkg.dsc.inc).
+//
+#if defined(UT_COVERAGE_GCOV)
+void __gcov_dump (void);
+#define UtWriteCoverage()                 __gcov_dump ()
+#elif defined(UT_COVERAGE_LLVM)
+int __llvm_profile_write_file (void);
+#define UtWriteCoverage()                 __llvm_profile_write_file ()
+#else
+#define UtWriteCoverage()
+#endif
+
+/**
+ * UtDiscardIteration
+ * @brief Closes the output files of the current iteration without writing to them.
+ *
+ * @param Ut  Test framework
+ */
+static
+void
+UtDiscardIteration (
   AMD_UNIT_TEST_FRAMEWORK *Ut
   )
+{
+  if (Ut->ResultFile != NULL) {
+    fclose (Ut->ResultFile);
+    cJSON_Delete(Ut->TestResultRoot);
+    Ut->ResultFile = NULL;
+    Ut->TestResultRoot = NULL;
+  }
+  if (Ut->LogFile != NULL) {
+    log_remove_fp (Ut->LogFile);
+    fclose (Ut->LogFile);
+    Ut->LogFile = NULL;
+  }
+}
+
+/**
+ * UtRunForkedIterations
+ * @brief Runs every iteration in a child process forked from the initialized test.
+ *
+ * @details The test process selects the iteration, which opens its output
+ *          files, and forks. The child runs the iteration, writes the result
+ *          and exits with the test status; the test process only closes its
+ *          copies of the files.
+ *          Nothing an iteration changes, including globals of the unit under
+ *          test and the fakes, is seen by the next one. If the child does
+ *          not exit, the test process writes the iteration result as ABORTED.
+ *
+ * @param Ut     Test framework
+ * @param Tests  One cmocka test per iteration
+ *
+ * @return Number of iterations that failed a cmocka check or did not exit
+ */
+static
+int
+UtRunForkedIterations (
+  AMD_UNIT_TEST_FRAMEWORK   *Ut,
+  const struct CMUnitTest   *Tests
+  )
+{
+  int       ReturnCode;
+  int       ChildStatus;
+  pid_t     Child;
+  uint32_t  Index;
+
+  ReturnCode = 0;
+  for (Index = 0; Index < Ut->TestIterationCount; Index++) {
+    if (Index != Ut->TestIterationIndex) {
+      UtEndIteration (Ut);
+      if (UtSelectIteration (Ut, Index) != AMD_UNIT_TEST_PASSED) {
+        UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
+        ReturnCode++;
+        continue;
+      }
+    }
+
+    fflush (NULL);
+    Child = fork ();
+    if (Child == 0) {
+      ForkedIteration = true;
+      ChildStatus = UtRunIterations (Ut, &Tests[Index], 1);
+      UtEndIteration (Ut);
+      fflush (NULL);
+      UtWriteCoverage ();
+      _exit (Ut->TestStatus | ((ChildStatus != 0) ? FORKED_ITERATION_CMOCKA_FAILURE : 0));
+    }
+
+    if ((Child > 0) && (waitpid (Child, &ChildStatus, 0) == Child) && WIFEXITED (ChildStatus)) {
+      if ((WEXITSTATUS (ChildStatus) & FORKED_ITERATION_CMOCKA_FAILURE) != 0) {
+        ReturnCode++;
+      }
+      UtSetTestStatus (Ut, (AMD_UNIT_TEST_STATUS)(WEXITSTATUS (ChildStatus) & FORKED_ITERATION_STATUS_MASK));
+      UtDiscardIteration (Ut);
+      continue;
+    }
+
+    if (Child < 0) {
+      Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+        "Failed to fork iteration %s. Test status was set to ABORTED.", Ut->TestIteration);
+    } else if (WIFSIGNALED (ChildStatus)) {
+      Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+        "Iteration %s was terminated by signal %d. Test status was set to ABORTED.",
+        Ut->TestIteration, WTERMSIG (ChildStatus));
+    } else {
+      Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+        "Iteration %s did not exit. Test status was set to ABORTED.", Ut->TestIteration);
+    }
+    UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
+    UtEndIteration (Ut);
+    ReturnCode++;
+  }
+  return ReturnCode;
+}
+
+#endif
+
+/**
+ * UtIsTestSelected
+ * @brief Checks whether the -t argument selects a test.
+ *
+ * @param TestFilter  -t argument: "*" or a comma separated list of test names
+ * @param Name        Test name
+ */
+static
+bool
+UtIsTestSelected (
+  const char  *TestFilter,
+  const char  *Name
+  )
+{
+  const char  *End;
+  size_t      Length;
+
+  if (strcmp (TestFilter, AMD_UNIT_TEST_ALL_TESTS) == 0) {
+    return true;
+  }
+  while (true) {
+    End    = strchr (TestFilter, AMD_UNIT_TEST_TEST_SEPARATOR);
+    Length = (End == NULL) ? strlen (TestFilter) : (size_t)(End - TestFilter);
+    if ((strlen (Name) == Length) && (strncmp (Name, TestFilter, Length) == 0)) {
+      return true;
+    }
+    if (End == NULL) {
+      return false;
+    }
+    TestFilter = End + 1;
+  }
+}
+
+/**
+ * UtOpenWorkerOutput
+ * @brief Opens the stream of worker responses on the standard output.
+ *
+ * @details Everything else the process prints to the standard output, e.g.
+ *          cmocka messages, is redirected to the standard error so that the
+ *          standard output carries nothing but responses.
+ *
+ * @return Response stream, or NULL on failure
+ */
+static
+FILE *
+UtOpenWorkerOutput (
+  void
+  )
+{
+  int   Fd;
+  FILE  *Output;
+
+  fflush (stdout);
+  Fd = UtDup (UtFileNo (stdout));
+  if (Fd < 0) {
+    return NULL;
+  }
+  Output = UtFdOpen (Fd, "w");
+  if ((Output == NULL) || (UtDup2 (UtFileNo (stderr), UtFileNo (stdout)) < 0)) {
+    return NULL;
+  }
+  return Output;
+}
+
+/**
+ * UtWorkerResponse
+ * @brief Prints the response to a run request.
+ *
+ * @param Request    Request (its "Id" is echoed), NULL if it is not valid JSON
+ * @param Test       Test name, NULL if unknown
+ * @param Iteration  Iteration name, NULL if unknown
+ * @param Status     Final test status
+ * @param Error      Reason the request was not run, NULL if it was
+ */
+static
+char *
+UtWorkerResponse (
+  cJSON       *Request,
+  const char  *Test,
+  const char  *Iteration,
+  const char  *Status,
+  const char  *Error
+  )
+{
+  cJSON *Response;
+  cJSON *Id;
+  char  *Line;
+
+  Response = cJSON_CreateObject();
+  if (Response == NULL) {
+    return NULL;
+  }
+  Id = cJSON_GetObjectItemCaseSensitive (Request, "Id");
+  if (Id != NULL) {
+    cJSON_AddItemToObject (Response, "Id", cJSON_Duplicate (Id, true));
+  }
+  if (Test != NULL) {
+    cJSON_AddStringToObject (Response, "Test", Test);
+  }
+  if (Iteration != NULL) {
+    cJSON_AddStringToObject (Response, "Iteration", Iteration);
+  }
+  cJSON_AddStringToObject (Response, "Status", Status);
+  if (Error != NULL) {
+    cJSON_AddStringToObject (Response, "Error", Error);
+  }
+  Line = cJSON_PrintUnformatted (Response);
+  cJSON_Delete (Response);
+  return Line;
+}
+
+/**
+ * UtWorkerRespond
+ * @brief Writes the response to a run request.
+ *
+ * @param Output     Response stream
+ * @param Request    Request (its "Id" is echoed), NULL if it is not valid JSON
+ * @param Test       Test name, NULL if unknown
+ * @param Iteration  Iteration name, NULL if unknown
+ * @param Status     Final test status
+ * @param Error      Reason the request was not run, NULL if it was
+ */
+static
+void
+UtWorkerRespond (
+  FILE        *Output,
+  cJSON       *Request,
+  const char  *Test,
+  const char  *Iteration,
+  const char  *Status,
+  const char  *Error
+  )
+{
+  char  *Line;
+
+  Line = UtWorkerResponse (Request, Test, Iteration, Status, Error);
+  if (Line != NULL) {
+    fputs (Line, Output);
+    fputs ("\n", Output);
+    fflush (Output);
+    cJSON_free (Line);
+  }
+}
+
+/**
+ * UtApplyConfigOverride
+ * @brief Overrides parameters of the current iteration with those of a run request.
+ *
+ * @param Ut        Test framework
+ * @param Override  "Config" object of the request
+ *
+ * @retval AMD_UNIT_TEST_PASSED   Parameters overridden
+ * @retval AMD_UNIT_TEST_ABORTED  Out of memory
+ */
+static
+AMD_UNIT_TEST_STATUS
+UtApplyConfigOverride (
+  AMD_UNIT_TEST_FRAMEWORK *Ut,
+  cJSON                   *Override
+  )
+{
+  cJSON *Item;
+  cJSON *Copy;
+
+  for (Item = Override->child; Item != NULL; Item = Item->next) {
+    Copy = cJSON_Duplicate (Item, true);
+    if (Copy == NULL) {
+      return AMD_UNIT_TEST_ABORTED;
+    }
+    if (cJSON_GetObjectItemCaseSensitive (Ut->TestConfigIteration, Item->string) != NULL) {
+      cJSON_ReplaceItemInObjectCaseSensitive (Ut->TestConfigIteration, Item->string, Copy);
+    } else {
+      cJSON_AddItemToObject (Ut->TestConfigIteration, Item->string, Copy);
+    }
+  }
+  return AMD_UNIT_TEST_PASSED;
+}
+
+/**
+ * UtServeRequests
+ * @brief Runs tests on request until the standard input is closed (--worker).
+ *
+ * @details Each line of the standard input is a JSON run request:
+ *
+ *            {"Id": 1, "Test": "Name", "Iteration": "Default", "OutPath": "...",
+ *             "ConfigFile": "...", "Config": {"Key": "Value"}}
+ *
+ *          Iteration and OutPath are mandatory. Test selects the test of a
+ *          test table binary and may be omitted when a single test is
+ *          selected. ConfigFile replaces -c, Config overrides parameters of
+ *          the iteration, Timeout (seconds) replaces -w. Each request runs
+ *          as a test started with the same arguments would, with its own
+ *          framework, log and result file, and is answered by one line on
+ *          the standard output:
+ *
+ *            {"Id": 1, "Test": "Name", "Iteration": "Default", "Status": "PASSED"}
+ *
+ *          Requests that cannot be run are answered with status ABORTED and
+ *          an "Error" string. A request that times out is answered with
+ *          status TIMEOUT and the worker exits, unless it runs in a forked
+ *          child: with -f every request runs in a forked child.
+ *
+ * @param Worker      Framework holding the command line arguments
+ * @param Tests       Test table
+ * @param TestCount   Number of entries in Tests
+ * @param TestFilter  -t argument
+ *
+ * @return 0 when the standard input is closed; -1 if the response stream cannot be opened.
+ */
+static
+int
+UtServeRequests (
+  AMD_UNIT_TEST_FRAMEWORK   *Worker,
+  const AMD_UNIT_TEST_ENTRY *Tests,
+  uint32_t                  TestCount,
+  const char                *TestFilter
+  )
+{
+  AMD_UNIT_TEST_FRAMEWORK   Ut;
+  AMD_UNIT_TEST_STATUS      Status;
+  FILE                      *Output;
+  char                      *Line;
+  cJSON                     *Request;
+  cJSON                     *Test;
+  cJSON                     *Iteration;
+  cJSON                     *OutPath;
+  cJSON                     *ConfigFile;
+  cJSON                     *Config;
+  cJSON                     *Timeout;
+  const AMD_UNIT_TEST_ENTRY *Entry;
+  uint32_t                  SelectedCount;
+  uint32_t                  Index;
+
+  Output = UtOpenWorkerOutput ();
+  Line   = (char*) malloc (AMD_UNIT_TEST_MAX_CONFIG_FILE_LENGTH);
+  if ((Output == NULL) || (Line == NULL)) {
+    Worker->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__, "Failed to start the worker.");
+    free (Line);
+    return -1;
+  }
+
+  SelectedCount = 0;
+  for (Index = 0; Index < TestCount; Index++) {
+    if (UtIsTestSelected (TestFilter, Tests[Index].Name)) {
+      SelectedCount++;
+    }
+  }
+
+  while (fgets (Line, AMD_UNIT_TEST_MAX_CONFIG_FILE_LENGTH, stdin) != NULL) {
+    if (strspn (Line, " \t\r\n") == strlen (Line)) {
+      continue;
+    }
+    Request = cJSON_Parse (Line);
+    if (!cJSON_IsObject (Request)) {
+      UtWorkerRespond (Output, NULL, NULL, NULL, "ABORTED", "Request is not a JSON object.");
+      cJSON_Delete (Request);
+      continue;
+    }
+
+    Test       = cJSON_GetObjectItemCaseSensitive (Request, "Test");
+    Iteration  = cJSON_GetObjectItemCaseSensitive (Request, "Iteration");
+    OutPath    = cJSON_GetObjectItemCaseSensitive (Request, "OutPath");
+    ConfigFile = cJSON_GetObjectItemCaseSensitive (Request, "ConfigFile");
+    Config     = cJSON_GetObjectItemCaseSensitive (Request, "Config");
+    Timeout    = cJSON_GetObjectItemCaseSensitive (Request, "Timeout");
+
+    Entry = NULL;
+    for (Index = 0; Index < TestCount; Index++) {
+      if (!UtIsTestSelected (TestFilter, Tests[Index].Name)) {
+        continue;
+      }
+      if (cJSON_IsString (Test) ? (strcmp (Test->valuestring, Tests[Index].Name) == 0) : (SelectedCount == 1)) {
+        Entry = &Tests[Index];
+        break;
+      }
+    }
+    if (Entry == NULL) {
+      UtWorkerRespond (Output, Request, cJSON_IsString (Test) ? Test->valuestring : NULL, NULL, "ABORTED",
+        cJSON_IsString (Test) ? "Test is not served by this worker." : "Request must name the test.");
+      cJSON_Delete (Request);
+      continue;
+    }
+    if (!cJSON_IsString (Iteration) || !cJSON_IsString (OutPath) ||
+        ((ConfigFile != NULL) && !cJSON_IsString (ConfigFile)) ||
+        ((Config != NULL) && !cJSON_IsObject (Config)) ||
+        ((Timeout != NULL) && (!cJSON_IsNumber (Timeout) || (Timeout->valuedouble < 0)))) {
+      UtWorkerRespond (Output, Request, Entry->Name, NULL, "ABORTED",
+        "Request needs Iteration and OutPath strings; ConfigFile must be a string, Config an object and Timeout a number.");
+      cJSON_Delete (Request);
+      continue;
+    }
+    if ((strcmp (Iteration->valuestring, AMD_UNIT_TEST_ALL_ITERATIONS) == 0) ||
+        (strchr (Iteration->valuestring, AMD_UNIT_TEST_ITERATION_SEPARATOR) != NULL)) {
+      UtWorkerRespond (Output, Request, Entry->Name, Iteration->valuestring, "ABORTED",
+        "A request runs a single iteration.");
+      cJSON_Delete (Request);
+      continue;
+    }
+
+    memset ((void*)&Ut, 0x00, sizeof(AMD_UNIT_TEST_FRAMEWORK));
+    UtSetTestStatus (&Ut, AMD_UNIT_TEST_STATUS_NOT_SET);
+    Ut.TestIteration   = Iteration->valuestring;
+    Ut.TestConfigFile  = (ConfigFile != NULL) ? ConfigFile->valuestring : Worker->TestConfigFile;
+    Ut.TestOutpath     = OutPath->valuestring;
+    Ut.TestContext     = Entry->Context;
+    Ut.ForkIterations  = Worker->ForkIterations;
+    Ut.WatchdogTimeout = (Timeout != NULL) ? (uint32_t) Timeout->valuedouble : Worker->WatchdogTimeout;
+
+    Status = UtSetTestName (&Ut, Entry->Name);
+    if (Status == AMD_UNIT_TEST_PASSED) {
+      Status = UtInit (&Ut);
+    } else {
+      UtDeinit (&Ut);
+    }
+    if (Status != AMD_UNIT_TEST_PASSED) {
+      UtWorkerRespond (Output, Request, Entry->Name, Iteration->valuestring, "ABORTED",
+        "Test failed to initialize; see its log.");
+      cJSON_Delete (Request);
+      continue;
+    }
+    if ((Config != NULL) && (UtApplyConfigOverride (&Ut, Config) != AMD_UNIT_TEST_PASSED)) {
+      Ut.Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
+        "Failed to apply the configuration override. Test status was set to ABORTED.");
+      UtSetTestStatus (&Ut, AMD_UNIT_TEST_ABORTED);
+    } else {
+      // Answered by UtWatchdogExpired if the iteration times out.
+      fflush (Output);
+      TimeoutReport.WorkerFile     = UtWatchdogFile (Output);
+      TimeoutReport.WorkerResponse = UtWorkerResponse (Request, Entry->Name, Iteration->valuestring, "TIMEOUT", NULL);
+      UtRunTestEntry (&Ut, Entry);
+      cJSON_free (TimeoutReport.WorkerResponse);
+      TimeoutReport.WorkerResponse = NULL;
+    }
+    UtDeinit (&Ut);
+    UtWorkerRespond (Output, Request, Entry->Name, Iteration->valuestring, UtGetTestStatusString (&Ut), NULL);
+    cJSON_Delete (Request);
+  }
+
+  free (Line);
+  fclose (Output);
+  UtSetActiveFrameworkHandle ((AMD_UNIT_TEST_FRAMEWORK_HANDLE)Worker);
+  return 0;
+}
+
+/**
+ * UtRunTestEntry
+ * @brief Runs the selected iterations of a test with the framework of UtInitFromArgs.
+ *
+ * @param Ut    Test framework
+ * @param Test  Test functions
+ *
+ * @return cmocka return code; 0 if every iteration ran to its end.
+ */
+int
+UtRunTestEntry (
+  AMD_UNIT_TEST_FRAMEWORK   *Ut,
+  const AMD_UNIT_TEST_ENTRY *Test
+  )
 {
   int                    ReturnCode;
   struct CMUnitTest      *Tests;
-  AMD_UNIT_TEST_WRAPPER  UnitTest;
+  AMD_UNIT_TEST_WRAPPER  *UnitTests;
+  uint32_t               Index;
 
-  UnitTest.Context       = Ut->TestContext;
-  UnitTest.PrereqFunc    = TestPrerequisite;
-  UnitTest.TestFunc      = TestBody;
-  UnitTest.CleanUpFunc   = TestCleanUp;
-
-  Tests                  = (struct CMUnitTest*) malloc (sizeof (struct CMUnitTest));
-  Tests[0].name          = Ut->TestName;
-  Tests[0].test_func     = AmdTestFunctionRunner;
-  Tests[0].setup_func    = AmdTestSetupFunctionRunner;
-  Tests[0].teardown_func = AmdTestTeardownFunctionRunner;
-  Tests[0].initial_state = &UnitTest;
+  if (Ut->WorkerMode) {
+    return UtServeRequests (Ut, Test, 1, AMD_UNIT_TEST_ALL_TESTS);
+  }
 
-  ReturnCode = _cmocka_run_group_tests(Ut->TestName, Tests, 0x1, NULL, NULL);
-  if (ReturnCode != 0) {
+  Tests     = (struct CMUnitTest*) malloc (Ut->TestIterationCount * sizeof (struct CMUnitTest));
+  UnitTests = (AMD_UNIT_TEST_WRAPPER*) malloc (Ut->TestIterationCount * sizeof (AMD_UNIT_TEST_WRAPPER));
+  if ((Tests == NULL) || (UnitTests == NULL)) {
     Ut->Log(AMD_UNIT_TEST_LOG_ERROR, __FUNCTION__, __LINE__,
-      "UtRunTest returned a non-zero value (%d). Test status was set to ABORTED.", ReturnCode);
+      "UtRunTest failed to allocate memory dynamically. Test status was set to ABORTED.");
     UtSetTestStatus (Ut, AMD_UNIT_TEST_ABORTED);
+    free (Tests);
+    free (UnitTests);
+    return -1;
+  }
+
+  //
+  // One cmocka test per iteration, so that all iterations run in this process.
+  //
+  for (Index = 0; Index < Ut->TestIterationCount; Index++) {
+    UnitTests[Index].Context        = Ut->TestContext;
+    UnitTests[Index].PrereqFunc     = Test->Prerequisite;
+    UnitTests[Index].TestFunc       = Test->Body;
+    UnitTests[Index].CleanUpFunc    = Test->CleanUp;
+    UnitTests[Index].IterationIndex = Index;
+    Tests[Index].name               = (Ut->TestOutputRoot == NULL) ? Ut->TestName : UtGetIterationName (Ut->TestIterations[Index]);
+    Tests[Index].test_func          = AmdTestFunctionRunner;
+    Tests[Index].setup_func         = AmdTestSetupFunctionRunner;
+    Tests[Index].teardown_func      = AmdTestTeardownFunctionRunner;
+    Tests[Index].initial_state      = &UnitTests[Index];
+  }
+
+  if (Ut->ForkIterations) {
+    ReturnCode = UtRunForkedIterations (Ut, Tests);
+  } else {
+    ReturnCode = UtRunIterations (Ut, Tests, Ut->TestIterationCount);
   }
   free (Tests);
+  free (UnitTests);
+  IterationActive = false;
+  UtRunResetHandlers ();
 
   return ReturnCode;
 }
 
+/**
+ * UtRunTestTable
+ * @brief Runs the unit tests of a test table binary.
+ *
+ * @details A test table binary hosts several unit tests, e.g. all tests of a
+ *          component, and calls this routine from main instead of defining
+ *          TestPrerequisite, TestBody and TestCleanUp. The tests selected by
+ *          -t run one after another in this process, each with its own
+ *          framework; the reset handlers run between them. When a single
+ *          test is selected, -c and -o are used as by a single test binary.
+ *          When several are, -c is the directory of the configuration files
+ *          (<TestName>.json) and each test writes to <-o>\<TestName>.
+ *
+ * @param argc       Argument count
+ * @param argv       Argument vector
+ * @param Tests      Test table
+ * @param TestCount  Number of entries in Tests
+ *
+ * @retval AMD_UNIT_TEST_PASSED   All selected tests were run
+ * @retval NON-ZERO               Unknown test selected, or a test failed to initialize
+ */
+AMD_UNIT_TEST_STATUS
+UtRunTestTable (
+  int                       argc,
+  char                      *argv[],
+  const AMD_UNIT_TEST_ENTRY *Tests,
+  uint32_t                  TestCount
+  )
+{
+  AMD_UNIT_TEST_FRAMEWORK Ut;
+  AMD_UNIT_TEST_STATUS    Status;
+  AMD_UNIT_TEST_STATUS    ReturnStatus;
+  char                    *TestIteration;
+  char                    *TestConfigFile;
+  char                    *TestOutpath;
+  char                    *TestFilter;
+  bool                    ForkIterations;
+  bool                    WorkerMode;
+  uint32_t                WatchdogTimeout;
+  char                    ConfigPath[AMD_UNIT_TEST_MAX_PATH_LENGTH];
+  char                    OutPath[AMD_UNIT_TEST_MAX_PATH_LENGTH];
+  const char              *Name;
+  const char              *End;
+  size_t                  Length;
+  uint32_t                SelectedCount;
+  uint32_t                Index;
+  int                     PathLength;
+
+  TestIteration   = NULL;
+  TestConfigFile  = NULL;
+  TestOutpath     = NULL;
+  TestFilter      = AMD_UNIT_TEST_ALL_TESTS;
+  ForkIterations  = false;
+  WorkerMode      = false;
+  WatchdogTimeout = 0;
+  UtParseArgs (argc, argv, &TestIteration, &TestConfigFile, &TestOutpath, &TestFilter, &ForkIterations, &WorkerMode,
+    &WatchdogTimeout);
+
+  //
+  // Every name of the filter must be in the table.
+  //
+  if (strcmp (TestFilter, AMD_UNIT_TEST_ALL_TESTS) != 0) {
+    Name = TestFilter;
+    while (true) {
+      End    = strchr (Name, AMD_UNIT_TEST_TEST_SEPARATOR);
+      Length = (End == NULL) ? strlen (Name) : (size_t)(End - Name);
+      for (Index = 0; Index < TestCount; Index++) {
+        if ((strlen (Tests[Index].Name) == Length) && (strncmp (Tests[Index].Name, Name, Length) == 0)) {
+          break;
+        }
+      }
+      if (Index == TestCount) {
+        printf ("Test '%.*s' is not in this test binary.\n", (int) Length, Name);
+        return AMD_UNIT_TEST_ABORTED;
+      }
+      if (End == NULL) {
+        break;
+      }
+      Name = End + 1;
+    }
+  }
+
+  SelectedCount = 0;
+  for (Index = 0; Index < TestCount; Index++) {
+    if (UtIsTestSelected (TestFilter, Tests[Index].Name)) {
+      SelectedCount++;
+    }
+  }
+  if (SelectedCount == 0) {
+    printf ("No test selected by '%s'.\n", TestFilter);
+    return AMD_UNIT_TEST_ABORTED;
+  }
+
+  if (WorkerMode) {
+    memset ((void*)&Ut, 0x00, sizeof(AMD_UNIT_TEST_FRAMEWORK));
+    Ut.TestConfigFile  = TestConfigFile;
+    Ut.ForkIterations  = ForkIterations;
+    Ut.WatchdogTimeout = WatchdogTimeout;
+    Ut.Log             = log_log;
+    UtServeRequests (&Ut, Tests, TestCount, TestFilter);
+    UtSetActiveFrameworkHandle (NULL);
+    return AMD_UNIT_TEST_PASSED;
+  }
+
+  ReturnStatus = AMD_UNIT_TEST_PASSED;
+  for (Index = 0; Index < TestCount; Index++) {
+    if (!UtIsTestSelected (TestFilter, Tests[Index].Name)) {
+      continue;
+    }
+
+    memset ((void*)&Ut, 0x00, sizeof(AMD_UNIT_TEST_FRAMEWORK));
+    UtSetTestStatus (&Ut, AMD_UNIT_TEST_STATUS_NOT_SET);
+    Ut.TestIteration   = TestIteration;
+    Ut.TestConfigFile  = TestConfigFile;
+    Ut.TestOutpath     = TestOutpath;
+    Ut.ForkIterations  = ForkIterations;
+    Ut.WatchdogTimeout = WatchdogTimeout;
+    if (SelectedCount > 1) {
+      PathLength = snprintf (ConfigPath, sizeof (ConfigPath), "%s" UT_PATH_SEPARATOR "%s.json", TestConfigFile, Tests[Index].Name);
+      if ((PathLength < 0) || (PathLength >= (int) sizeof (ConfigPath))) {
+        printf ("Test configuration file path of %s exceeds the maximum path length allowed (%d).\n",
+          Tests[Index].Name, AMD_UNIT_TEST_MAX_PATH_LENGTH);
+        ReturnStatus = AMD_UNIT_TEST_ABORTED;
+        continue;
+      }
+      PathLength = snprintf (OutPath, sizeof (OutPath), "%s" UT_PATH_SEPARATOR "%s", TestOutpath, Tests[Index].Name);
+      if ((PathLength < 0) || (PathLength >= (int) sizeof (OutPath))) {
+        printf ("Test output path of %s exceeds the maximum path length allowed (%d).\n",
+          Tests[Index].Name, AMD_UNIT_TEST_MAX_PATH_LENGTH);
+        ReturnStatus = AMD_UNIT_TEST_ABORTED;
+        continue;
+      }
+      UtMakeDirectory (OutPath);
+      Ut.TestConfigFile = ConfigPath;
+      Ut.TestOutpath    = OutPath;
+    }
+
+    Ut.TestContext = Tests[Index].Context;
+    Status = UtSetTestName (&Ut, Tests[Index].Name);
+    if (Status == AMD_UNIT_TEST_PASSED) {
+      Status = UtInit (&Ut);
+    } else {
+      UtDeinit (&Ut);
+    }
+    if (Status != AMD_UNIT_TEST_PASSED) {
+      printf ("Test %s failed to initialize (Status=0x%x).\n", Tests[Index].Name, Status);
+      ReturnStatus = Status;
+      continue;
+    }
+
+    Ut.Log(AMD_UNIT_TEST_LOG_INFO, __FUNCTION__, __LINE__,
+      "Test %s started. TestStatus is %s.", UtGetTestName (&Ut), UtGetTestStatusString (&Ut));
+    UtRunTestEntry (&Ut, &Tests[Index]);
+    Ut.Log(AMD_UNIT_TEST_LOG_INFO, __FUNCTION__, __LINE__, "Test %s ended.", UtGetTestName (&Ut));
+    UtDeinit (&Ut);
+  }
+  UtSetActiveFrameworkHandle (NULL);
+
+  return ReturnStatus;
+}
+
 void
 UtDeinit (
   AMD_UNIT_TEST_FRAMEWORK *Ut
   )
 {
+  UtEndIteration (Ut);
+  if (Ut->SessionLogFile != NULL) {
+    Ut->Log(AMD_UNIT_TEST_LOG_INFO, __FUNCTION__, __LINE__, "Test session ended.");
+    log_remove_fp (Ut->SessionLogFile);
+    fclose (Ut->SessionLogFile);
+    Ut->SessionLogFile = NULL;
+  }
   if (Ut->TestName != NULL) {
     free (Ut->TestName);
     Ut->TestName = NULL;
@@ -518,17 +2062,14 @@ UtDeinit (
     Ut->TestConfigRoot = NULL;
     Ut->TestConfigIteration = NULL;
   }
-  if (Ut->ResultFile != NULL) {
-    UtAddElementToResult (Ut, "Status", UtGetTestStatusString (Ut));
-    UtWrite2ResultFile (Ut);
-    fclose (Ut->ResultFile);
-    cJSON_Delete(Ut->TestResultRoot);
-    Ut->ResultFile = NULL;
-    Ut->TestResultRoot = NULL;
+  if (Ut->TestIterations != NULL) {
+    free (Ut->TestIterations);
+    Ut->TestIterations = NULL;
+    Ut->TestIterationCount = 0;
   }
-  if (Ut->LogFile != NULL) {
-    Ut->Log(AMD_UNIT_TEST_LOG_INFO, __FUNCTION__, __LINE__, "Final Test Status was %s.", UtGetTestStatusString (Ut));
-    fclose (Ut->LogFile);
-    Ut->LogFile = NULL;
+  if (Ut->TestOutputRoot != NULL) {
+    free (Ut->TestOutpath);
+    Ut->TestOutpath = Ut->TestOutputRoot;
+    Ut->TestOutputRoot = NULL;
   }
 }
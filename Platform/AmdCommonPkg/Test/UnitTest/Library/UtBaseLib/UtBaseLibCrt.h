@@ -0,0 +1,95 @@
+/* Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved. */
+// SPDX-License-Identifier: MIT
+/**
+ * @file  UtBaseLibCrt.h
+ * @brief Bounds-checked C runtime functions of UtBaseLib on POSIX hosts
+ *
+ * @details UtBaseLib uses the bounds-checked functions of the Windows C
+ *          runtime. Other hosts get equivalents that fail the same way: a
+ *          destination too small for the result is emptied and a non-zero
+ *          value is returned.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#if !defined(_WIN32)
+
+static inline
+int
+strcpy_s (
+  char        *Destination,
+  size_t      Size,
+  const char  *Source
+  )
+{
+  size_t Length;
+
+  if ((Destination == NULL) || (Size == 0)) {
+    return EINVAL;
+  }
+  Length = (Source == NULL) ? 0 : strlen (Source);
+  if ((Source == NULL) || (Length >= Size)) {
+    Destination[0] = '\0';
+    return (Source == NULL) ? EINVAL : ERANGE;
+  }
+  memcpy (Destination, Source, Length + 1);
+  return 0;
+}
+
+static inline
+int
+strcat_s (
+  char        *Destination,
+  size_t      Size,
+  const char  *Source
+  )
+{
+  size_t Length;
+  int    Status;
+
+  if ((Destination == NULL) || (Size == 0)) {
+    return EINVAL;
+  }
+  Length = strnlen (Destination, Size);
+  if (Length == Size) {
+    Destination[0] = '\0';
+    return EINVAL;
+  }
+  Status = strcpy_s (Destination + Length, Size - Length, Source);
+  if (Status != 0) {
+    Destination[0] = '\0';
+  }
+  return Status;
+}
+
+static inline
+int
+fopen_s (
+  FILE        **File,
+  const char  *Path,
+  const char  *Mode
+  )
+{
+  if (File == NULL) {
+    return EINVAL;
+  }
+  *File = fopen (Path, Mode);
+  return (*File == NULL) ? errno : 0;
+}
+
+static inline
+int
+localtime_s (
+  struct tm     *Time,
+  const time_t  *Timer
+  )
+{
+  return (localtime_r (Timer, Time) == NULL) ? EINVAL : 0;
+}
+
+#endif
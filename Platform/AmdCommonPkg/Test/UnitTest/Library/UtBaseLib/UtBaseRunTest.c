@@ -0,0 +1,32 @@
+/* Copyright (C) 2021 - 2024 Advanced Micro Devices, Inc. All rights reserved. */
+// SPDX-License-Identifier: MIT
+/**
+ * @file  UtBaseRunTest.c
+ * @brief Test runner of single test binaries
+ *
+ * @details Kept apart from UtBaseLib.c so that test table binaries, which do
+ *          not define TestPrerequisite, TestBody and TestCleanUp, link without
+ *          them.
+ */
+
+#include <UtBaseLib.h>
+
+extern AMD_UNIT_TEST_STATUS TestPrerequisite (AMD_UNIT_TEST_CONTEXT Context);
+extern void                 TestBody (AMD_UNIT_TEST_CONTEXT Context);
+extern AMD_UNIT_TEST_STATUS TestCleanUp (AMD_UNIT_TEST_CONTEXT Context);
+
+int
+UtRunTest (
+  AMD_UNIT_TEST_FRAMEWORK *Ut
+  )
+{
+  AMD_UNIT_TEST_ENTRY Test;
+
+  Test.Name          = Ut->TestName;
+  Test.Prerequisite  = TestPrerequisite;
+  Test.Body          = TestBody;
+  Test.CleanUp       = TestCleanUp;
+  Test.Context       = Ut->TestContext;
+
+  return UtRunTestEntry (Ut, &Test);
+}
@@ -11,6 +11,7 @@
 #include <string.h>
 #include <malloc.h>
 #include "Log.h"
+#include "UtBaseLibCrt.h"
 #include <UtLogLib.h>
 
 void
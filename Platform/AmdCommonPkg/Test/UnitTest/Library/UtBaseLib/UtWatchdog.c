@@ -0,0 +1,360 @@
+/* Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved. */
+// SPDX-License-Identifier: MIT
+/**
+ * @file  UtWatchdog.c
+ * @brief Iteration watchdog timer of UtBaseLib
+ *
+ * @details A single watchdog, armed by UtWatchdogStart and disarmed by
+ *          UtWatchdogStop or a new UtWatchdogStart. POSIX hosts use a
+ *          SIGALRM interval timer, Windows a monitor thread waiting for the
+ *          stop event, which suspends the test thread before calling the
+ *          expiry handler. Kept apart from UtBaseLib.c so that windows.h is
+ *          not mixed with the UEFI headers.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "UtWatchdog.h"
+
+#if defined(_WIN32)
+
+#include <windows.h>
+#include <io.h>
+
+static HANDLE               mWatchdogThread     = NULL;
+static HANDLE               mWatchdogStopEvent  = NULL;
+static HANDLE               mWatchdogTestThread = NULL;
+static DWORD                mWatchdogTimeout    = 0;
+static ULONGLONG            mWatchdogStart      = 0;
+static UT_WATCHDOG_HANDLER  mWatchdogHandler    = NULL;
+
+static
+DWORD
+WINAPI
+UtWatchdogMonitor (
+  LPVOID  Parameter
+  )
+{
+  CONTEXT Context;
+
+  if (WaitForSingleObject (mWatchdogStopEvent, mWatchdogTimeout) == WAIT_TIMEOUT) {
+    //
+    // SuspendThread returns before the thread is stopped on multiprocessor
+    // hosts; GetThreadContext waits for it.
+    //
+    if (SuspendThread (mWatchdogTestThread) != (DWORD) -1) {
+      Context.ContextFlags = CONTEXT_CONTROL;
+      GetThreadContext (mWatchdogTestThread, &Context);
+    }
+    mWatchdogHandler (GetTickCount64 () - mWatchdogStart);
+  }
+  return 0;
+}
+
+/**
+ * UtWatchdogStart
+ * @brief Calls Handler unless the watchdog is stopped within Seconds.
+ *
+ * @details The calling thread is the one suspended on expiry.
+ *
+ * @param Seconds  Timeout
+ * @param Handler  Expiry handler
+ *
+ * @retval true   Watchdog armed
+ * @retval false  The monitor thread cannot be created
+ */
+bool
+UtWatchdogStart (
+  uint32_t             Seconds,
+  UT_WATCHDOG_HANDLER  Handler
+  )
+{
+  UtWatchdogStop ();
+  if (!DuplicateHandle (GetCurrentProcess (), GetCurrentThread (), GetCurrentProcess (), &mWatchdogTestThread,
+         THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT, FALSE, 0)) {
+    mWatchdogTestThread = NULL;
+    return false;
+  }
+  mWatchdogStopEvent = CreateEvent (NULL, TRUE, FALSE, NULL);
+  if (mWatchdogStopEvent == NULL) {
+    CloseHandle (mWatchdogTestThread);
+    mWatchdogTestThread = NULL;
+    return false;
+  }
+  mWatchdogHandler = Handler;
+  mWatchdogTimeout = Seconds * 1000;
+  mWatchdogStart   = GetTickCount64 ();
+  mWatchdogThread  = CreateThread (NULL, 0, UtWatchdogMonitor, NULL, 0, NULL);
+  if (mWatchdogThread == NULL) {
+    CloseHandle (mWatchdogStopEvent);
+    CloseHandle (mWatchdogTestThread);
+    mWatchdogStopEvent  = NULL;
+    mWatchdogTestThread = NULL;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * UtWatchdogStop
+ * @brief Disarms the watchdog; returns once its monitor thread is over.
+ */
+void
+UtWatchdogStop (
+  void
+  )
+{
+  if (mWatchdogThread == NULL) {
+    return;
+  }
+  SetEvent (mWatchdogStopEvent);
+  WaitForSingleObject (mWatchdogThread, INFINITE);
+  CloseHandle (mWatchdogThread);
+  CloseHandle (mWatchdogStopEvent);
+  CloseHandle (mWatchdogTestThread);
+  mWatchdogThread     = NULL;
+  mWatchdogStopEvent  = NULL;
+  mWatchdogTestThread = NULL;
+}
+
+/**
+ * UtWatchdogFile
+ * @brief Returns the file of a stream for UtWatchdogWrite.
+ *
+ * @details Call it before the watchdog expires: it takes the C runtime locks.
+ *
+ * @param File  Stream, NULL for none
+ *
+ * @return OS handle of the stream, UT_WATCHDOG_NO_FILE for none.
+ */
+UT_WATCHDOG_FILE
+UtWatchdogFile (
+  FILE  *File
+  )
+{
+  if (File == NULL) {
+    return UT_WATCHDOG_NO_FILE;
+  }
+  return (UT_WATCHDOG_FILE) _get_osfhandle (_fileno (File));
+}
+
+/**
+ * UtWatchdogWrite
+ * @brief Writes to a file from the expiry handler, bypassing the C runtime.
+ *
+ * @param File    File from UtWatchdogFile
+ * @param Text    Data to write
+ * @param Length  Number of bytes to write
+ */
+void
+UtWatchdogWrite (
+  UT_WATCHDOG_FILE  File,
+  const char        *Text,
+  size_t            Length
+  )
+{
+  DWORD Written;
+
+  if (File == UT_WATCHDOG_NO_FILE) {
+    return;
+  }
+  while (Length > 0) {
+    if (!WriteFile ((HANDLE) File, Text, (DWORD) Length, &Written, NULL) || (Written == 0)) {
+      return;
+    }
+    Text   += Written;
+    Length -= Written;
+  }
+}
+
+/**
+ * UtWatchdogExit
+ * @brief Ends the process from the expiry handler, without running the exit handlers.
+ *
+ * @param Status  Exit code
+ */
+void
+UtWatchdogExit (
+  int  Status
+  )
+{
+  TerminateProcess (GetCurrentProcess (), (UINT) Status);
+}
+
+/**
+ * UtWatchdogFence
+ * @brief Makes the memory written so far visible to the expiry handler before what is written next.
+ */
+void
+UtWatchdogFence (
+  void
+  )
+{
+  MemoryBarrier ();
+}
+
+#else
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+static uint64_t                      mWatchdogStart   = 0;
+static volatile UT_WATCHDOG_HANDLER  mWatchdogHandler = NULL;
+
+static
+uint64_t
+UtWatchdogNow (
+  void
+  )
+{
+  struct timespec Now;
+
+  clock_gettime (CLOCK_MONOTONIC, &Now);
+  return (uint64_t) Now.tv_sec * 1000 + (uint64_t) Now.tv_nsec / 1000000;
+}
+
+static
+void
+UtWatchdogSignal (
+  int  Signal
+  )
+{
+  UT_WATCHDOG_HANDLER Handler;
+
+  Handler = mWatchdogHandler;
+  if (Handler != NULL) {
+    Handler (UtWatchdogNow () - mWatchdogStart);
+  }
+}
+
+/**
+ * UtWatchdogStart
+ * @brief Calls Handler unless the watchdog is stopped within Seconds.
+ *
+ * @param Seconds  Timeout
+ * @param Handler  Expiry handler
+ *
+ * @retval true   Watchdog armed
+ * @retval false  The SIGALRM handler or the timer cannot be set
+ */
+bool
+UtWatchdogStart (
+  uint32_t             Seconds,
+  UT_WATCHDOG_HANDLER  Handler
+  )
+{
+  struct sigaction  Action;
+  struct itimerval  Timer;
+
+  UtWatchdogStop ();
+  memset (&Action, 0, sizeof (Action));
+  Action.sa_handler = UtWatchdogSignal;
+  sigemptyset (&Action.sa_mask);
+  if (sigaction (SIGALRM, &Action, NULL) != 0) {
+    return false;
+  }
+  mWatchdogStart   = UtWatchdogNow ();
+  mWatchdogHandler = Handler;
+  memset (&Timer, 0, sizeof (Timer));
+  Timer.it_value.tv_sec = Seconds;
+  if (setitimer (ITIMER_REAL, &Timer, NULL) != 0) {
+    mWatchdogHandler = NULL;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * UtWatchdogStop
+ * @brief Disarms the watchdog.
+ */
+void
+UtWatchdogStop (
+  void
+  )
+{
+  struct itimerval Timer;
+
+  memset (&Timer, 0, sizeof (Timer));
+  setitimer (ITIMER_REAL, &Timer, NULL);
+  mWatchdogHandler = NULL;
+}
+
+/**
+ * UtWatchdogFile
+ * @brief Returns the file of a stream for UtWatchdogWrite.
+ *
+ * @param File  Stream, NULL for none
+ *
+ * @return File descriptor of the stream, UT_WATCHDOG_NO_FILE for none.
+ */
+UT_WATCHDOG_FILE
+UtWatchdogFile (
+  FILE  *File
+  )
+{
+  if (File == NULL) {
+    return UT_WATCHDOG_NO_FILE;
+  }
+  return (UT_WATCHDOG_FILE) fileno (File);
+}
+
+/**
+ * UtWatchdogWrite
+ * @brief Writes to a file from the expiry handler with write(2), which is async-signal-safe.
+ *
+ * @param File    File from UtWatchdogFile
+ * @param Text    Data to write
+ * @param Length  Number of bytes to write
+ */
+void
+UtWatchdogWrite (
+  UT_WATCHDOG_FILE  File,
+  const char        *Text,
+  size_t            Length
+  )
+{
+  ssize_t Written;
+
+  if (File == UT_WATCHDOG_NO_FILE) {
+    return;
+  }
+  while (Length > 0) {
+    Written = write ((int) File, Text, Length);
+    if (Written <= 0) {
+      return;
+    }
+    Text   += Written;
+    Length -= (size_t) Written;
+  }
+}
+
+/**
+ * UtWatchdogExit
+ * @brief Ends the process from the expiry handler with _exit, without running the exit handlers.
+ *
+ * @param Status  Exit code
+ */
+void
+UtWatchdogExit (
+  int  Status
+  )
+{
+  _exit (Status);
+}
+
+/**
+ * UtWatchdogFence
+ * @brief Makes the memory written so far visible to the expiry handler before what is written next.
+ */
+void
+UtWatchdogFence (
+  void
+  )
+{
+  __atomic_signal_fence (__ATOMIC_SEQ_CST);
+}
+
+#endif
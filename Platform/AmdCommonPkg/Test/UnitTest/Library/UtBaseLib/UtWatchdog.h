@@ -0,0 +1,62 @@
+/* Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved. */
+// SPDX-License-Identifier: MIT
+/**
+ * @file  UtWatchdog.h
+ * @brief Iteration watchdog timer of UtBaseLib
+ *
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Called once the watchdog expires, with the time elapsed since it was
+ * started: from a signal handler on POSIX hosts, from a monitor thread on
+ * Windows once the thread that started the watchdog is suspended. The
+ * iteration may have been stopped anywhere, e.g. in malloc or holding a
+ * stdio lock: the handler may only use UtWatchdogWrite, UtWatchdogExit and
+ * functions that neither allocate nor lock.
+ */
+typedef void (*UT_WATCHDOG_HANDLER) (uint64_t ElapsedMs);
+
+/// File written by UtWatchdogWrite: a descriptor on POSIX hosts, a handle on Windows.
+typedef intptr_t UT_WATCHDOG_FILE;
+
+#define UT_WATCHDOG_NO_FILE  ((UT_WATCHDOG_FILE) -1)
+
+bool
+UtWatchdogStart (
+  uint32_t             Seconds,
+  UT_WATCHDOG_HANDLER  Handler
+  );
+
+void
+UtWatchdogStop (
+  void
+  );
+
+UT_WATCHDOG_FILE
+UtWatchdogFile (
+  FILE  *File
+  );
+
+void
+UtWatchdogWrite (
+  UT_WATCHDOG_FILE  File,
+  const char        *Text,
+  size_t            Length
+  );
+
+void
+UtWatchdogExit (
+  int  Status
+  );
+
+void
+UtWatchdogFence (
+  void
+  );
@@ -0,0 +1,346 @@
+# Copyright 2024 Advanced Micro Devices, Inc. All rights reserved.
+# SPDX-License-Identifier: MIT
+
+import os
+import sys
+import json
+import time
+import zlib
+import sqlite3
+import logging
+import argparse
+
+COVERAGE_MANIFEST_FILE="coverage_manifest.json"
+COVERAGE_DB_FILE="coverage.db"
+# Iteration name of coverage collected per test (dispatcher "UseWorkers")
+ALL_ITERATIONS="*"
+
+SCHEMA = """
+CREATE TABLE IF NOT EXISTS files (
+  id    INTEGER PRIMARY KEY,
+  path  TEXT UNIQUE NOT NULL,   -- Normalized: lower case, '/'
+  name  TEXT NOT NULL           -- As in the coverage info
+);
+CREATE TABLE IF NOT EXISTS runs (
+  id        INTEGER PRIMARY KEY,
+  test      TEXT NOT NULL,
+  iteration TEXT NOT NULL,
+  lcov      TEXT NOT NULL,
+  mtime     REAL NOT NULL,
+  size      INTEGER NOT NULL,
+  UNIQUE (test, iteration)
+);
+CREATE TABLE IF NOT EXISTS branches (
+  file_id INTEGER NOT NULL,
+  line    INTEGER NOT NULL,
+  block   TEXT NOT NULL,
+  branch  TEXT NOT NULL,
+  bit     INTEGER NOT NULL,
+  PRIMARY KEY (file_id, line, block, branch)
+);
+CREATE TABLE IF NOT EXISTS coverage (
+  run_id       INTEGER NOT NULL,
+  file_id      INTEGER NOT NULL,
+  line_hit     BLOB NOT NULL,     -- Bitmaps, see ut_pack_bitmap
+  line_found   BLOB NOT NULL,
+  branch_hit   BLOB NOT NULL,
+  branch_found BLOB NOT NULL,
+  PRIMARY KEY (run_id, file_id)
+);
+CREATE INDEX IF NOT EXISTS coverage_file ON coverage (file_id);
+"""
+
+def ut_pack_bitmap(bitmap):
+  """
+  Stores a bitmap (Python int, bit N set for line or branch N) as zlib
+  compressed little-endian bytes.
+  """
+  return zlib.compress(bitmap.to_bytes((bitmap.bit_length() + 7) // 8, "little"))
+
+def ut_unpack_bitmap(blob):
+  return int.from_bytes(zlib.decompress(blob), "little")
+
+def ut_bits(bitmap):
+  """
+  Returns the set bit numbers of a bitmap, in order.
+  """
+  bits = []
+  while bitmap:
+    low = bitmap & -bitmap
+    bits.append(low.bit_length() - 1)
+    bitmap ^= low
+  return bits
+
+def ut_normalize(path):
+  return path.strip().replace("\\", "/").lower()
+
+def ut_read_lcov(lcov_file):
+  """
+  Returns {source file: (line hits, line found, branch hits, branch found)}
+  of an lcov file; lines as {line: count}, branches as {(line, block,
+  branch): taken}.
+  """
+  records = {}
+  current = None
+  with open(lcov_file) as fp:
+    for line in fp:
+      line = line.strip()
+      if line.startswith("SF:"):
+        current = records.setdefault(line[3:], ({}, {}))
+      elif line == "end_of_record":
+        current = None
+      elif current is None:
+        continue
+      elif line.startswith("DA:"):
+        fields = line[3:].split(",")
+        number = int(fields[0])
+        current[0][number] = current[0].get(number, 0) + int(fields[1])
+      elif line.startswith("BRDA:"):
+        number, block, branch, taken = line[5:].split(",", 3)
+        key = (int(number), block, branch)
+        current[1][key] = current[1].get(key, 0) + (0 if taken == "-" else int(taken))
+  return records
+
+class UtCoverageDb():
+  """
+  Line and branch coverage of every test iteration, one bitmap per
+  (test, iteration, source file), in a sqlite database.
+  """
+  def __init__(self, path):
+    self.db = sqlite3.connect(path)
+    self.db.executescript(SCHEMA)
+    self.file_ids = {}
+
+  def file_id(self, name):
+    path = ut_normalize(name)
+    if path not in self.file_ids:
+      self.db.execute("INSERT OR IGNORE INTO files (path, name) VALUES (?, ?)", (path, name))
+      self.file_ids[path] = self.db.execute("SELECT id FROM files WHERE path = ?", (path,)).fetchone()[0]
+    return self.file_ids[path]
+
+  def branch_bits(self, file_id, branches):
+    """
+    Returns the bit of each branch of a file, numbering new branches after
+    the known ones so that the bitmaps of all iterations agree.
+    """
+    bits = {(line, block, branch): bit for line, block, branch, bit in self.db.execute(
+      "SELECT line, block, branch, bit FROM branches WHERE file_id = ?", (file_id,))}
+    next_bit = max(bits.values(), default=-1) + 1
+    for key in sorted(set(branches) - set(bits)):
+      bits[key] = next_bit
+      self.db.execute("INSERT INTO branches (file_id, line, block, branch, bit) VALUES (?, ?, ?, ?, ?)",
+        (file_id, key[0], key[1], key[2], next_bit))
+      next_bit += 1
+    return bits
+
+  def add_run(self, test, iteration, lcov_file):
+    """
+    Loads the coverage of one test iteration, replacing what was known of it.
+    Returns False if the coverage info file did not change since then.
+    """
+    stat = os.stat(lcov_file)
+    row = self.db.execute("SELECT id, mtime, size FROM runs WHERE test = ? AND iteration = ?", (test, iteration)).fetchone()
+    if row is not None:
+      if row[1] == stat.st_mtime and row[2] == stat.st_size:
+        return False
+      self.db.execute("DELETE FROM coverage WHERE run_id = ?", (row[0],))
+      self.db.execute("DELETE FROM runs WHERE id = ?", (row[0],))
+    run_id = self.db.execute("INSERT INTO runs (test, iteration, lcov, mtime, size) VALUES (?, ?, ?, ?, ?)",
+      (test, iteration, lcov_file, stat.st_mtime, stat.st_size)).lastrowid
+
+    for name, (lines, branches) in ut_read_lcov(lcov_file).items():
+      file_id = self.file_id(name)
+      bits = self.branch_bits(file_id, branches)
+      line_hit = line_found = branch_hit = branch_found = 0
+      for number, count in lines.items():
+        line_found |= 1 << number
+        if count > 0:
+          line_hit |= 1 << number
+      for key, taken in branches.items():
+        branch_found |= 1 << bits[key]
+        if taken > 0:
+          branch_hit |= 1 << bits[key]
+      self.db.execute("INSERT INTO coverage VALUES (?, ?, ?, ?, ?, ?)", (run_id, file_id,
+        ut_pack_bitmap(line_hit), ut_pack_bitmap(line_found), ut_pack_bitmap(branch_hit), ut_pack_bitmap(branch_found)))
+    return True
+
+  def remove_runs(self, keep):
+    """
+    Drops the runs whose (test, iteration) is not in keep.
+    """
+    for run_id, test, iteration in self.runs():
+      if (test, iteration) not in keep:
+        self.db.execute("DELETE FROM coverage WHERE run_id = ?", (run_id,))
+        self.db.execute("DELETE FROM runs WHERE id = ?", (run_id,))
+
+  def files(self, name):
+    """
+    Returns [(file id, name)] of the source files whose path ends with name.
+    """
+    path = ut_normalize(name)
+    return [(file_id, file_name) for file_id, file_path, file_name in self.db.execute("SELECT id, path, name FROM files")
+      if file_path == path or file_path.endswith("/" + path)]
+
+  def runs(self, test=None, iteration=None):
+    query = "SELECT id, test, iteration FROM runs"
+    conditions = []
+    args = []
+    if test is not None:
+      conditions.append("test = ?")
+      args.append(test)
+    if iteration is not None:
+      conditions.append("iteration = ?")
+      args.append(iteration)
+    if conditions:
+      query += " WHERE " + " AND ".join(conditions)
+    return self.db.execute(query, args).fetchall()
+
+  def coverage(self, file_id=None):
+    """
+    Yields (run id, file id, line hit, line found, branch hit, branch found)
+    bitmaps, of one source file or of all.
+    """
+    query = "SELECT run_id, file_id, line_hit, line_found, branch_hit, branch_found FROM coverage"
+    rows = self.db.execute(query + " WHERE file_id = ?", (file_id,)) if file_id is not None else self.db.execute(query)
+    for run_id, row_file_id, line_hit, line_found, branch_hit, branch_found in rows:
+      yield (run_id, row_file_id, ut_unpack_bitmap(line_hit), ut_unpack_bitmap(line_found),
+             ut_unpack_bitmap(branch_hit), ut_unpack_bitmap(branch_found))
+
+  def commit(self):
+    self.db.commit()
+
+def ut_build(db, results_path, prune):
+  """
+  Loads the coverage info files listed by the dispatcher manifest of a
+  results folder; unchanged ones are skipped. Runs no longer listed are
+  kept, since a manifest may list some tests only, unless prune is set.
+  """
+  manifest_file = os.path.join(results_path, COVERAGE_MANIFEST_FILE)
+  if not os.path.isfile(manifest_file):
+    logging.error("Coverage manifest (i.e., {}) does not exist.".format(manifest_file))
+    sys.exit(1)
+  with open(manifest_file) as fp:
+    manifest = json.load(fp)
+
+  loaded = skipped = 0
+  listed = set()
+  for entries in manifest["Targets"].values():
+    for entry in entries:
+      lcov_file = os.path.join(results_path, entry["Path"])
+      if not os.path.isfile(lcov_file):
+        logging.warning("Coverage info file {} does not exist. File skipped.".format(lcov_file))
+        continue
+      iteration = entry["Iteration"] if entry["Iteration"] is not None else ALL_ITERATIONS
+      listed.add((entry["Test"], iteration))
+      if db.add_run(entry["Test"], iteration, lcov_file):
+        loaded += 1
+      else:
+        skipped += 1
+  if prune:
+    db.remove_runs(listed)
+  db.commit()
+  logging.info("{} coverage info file(s) loaded, {} unchanged.".format(loaded, skipped))
+
+def ut_covers(db, name, line, branches):
+  """
+  Prints the iterations that execute a source line (or take one of its
+  branches).
+  """
+  runs = {run_id: (test, iteration) for run_id, test, iteration in db.runs()}
+  for file_id, file_name in db.files(name):
+    bits = [1 << line]
+    if branches:
+      bits = [1 << bit for (branch_line, _, _), bit in db.branch_bits(file_id, {}).items() if branch_line == line]
+    for run_id, _, line_hit, _, branch_hit, _ in db.coverage(file_id):
+      hit = branch_hit if branches else line_hit
+      if any(hit & bit for bit in bits):
+        print("{}\t{}\t{}:{}".format(*runs[run_id], file_name, line))
+
+def ut_unique(db, test, iteration):
+  """
+  Prints, per source file, the lines and branches covered by the runs of a
+  test (or one of its iterations) and by no other test.
+  """
+  selected = set(run_id for run_id, _, _ in db.runs(test, iteration))
+  if not selected:
+    logging.error("No coverage of test {} in the database.".format(test))
+    sys.exit(1)
+  # Other iterations of the same test do not count as other coverage.
+  same_test = set(run_id for run_id, _, _ in db.runs(test))
+  names = {file_id: name for file_id, _, name in db.db.execute("SELECT id, path, name FROM files")}
+  own = {}
+  others = {}
+  for run_id, file_id, line_hit, _, branch_hit, _ in db.coverage():
+    if run_id in selected:
+      lines, branches = own.get(file_id, (0, 0))
+      own[file_id] = (lines | line_hit, branches | branch_hit)
+    elif run_id not in same_test:
+      lines, branches = others.get(file_id, (0, 0))
+      others[file_id] = (lines | line_hit, branches | branch_hit)
+  for file_id, (lines, branches) in sorted(own.items(), key=lambda item: names[item[0]]):
+    other_lines, other_branches = others.get(file_id, (0, 0))
+    unique_lines = ut_bits(lines & ~other_lines)
+    unique_branches = ut_bits(branches & ~other_branches)
+    print("{}: {} unique line(s), {} unique branch(es)".format(names[file_id], len(unique_lines), len(unique_branches)))
+    if unique_lines:
+      print("  lines: {}".format(" ".join(str(line) for line in unique_lines)))
+
+def ut_stats(db):
+  """
+  Prints the combined line coverage of every source file.
+  """
+  names = {file_id: name for file_id, _, name in db.db.execute("SELECT id, path, name FROM files")}
+  files = {}
+  for run_id, file_id, line_hit, line_found, _, _ in db.coverage():
+    hit, found, runs = files.get(file_id, (0, 0, 0))
+    files[file_id] = (hit | line_hit, found | line_found, runs + 1)
+  for file_id, (hit, found, runs) in sorted(files.items(), key=lambda item: names[item[0]]):
+    found_cnt = bin(found).count("1")
+    hit_cnt = bin(hit).count("1")
+    percentage = "{:.1f}".format(100.0 * hit_cnt / found_cnt) if found_cnt else "NA"
+    print("{}: {}% ({} of {} lines) by {} run(s)".format(names[file_id], percentage, hit_cnt, found_cnt, runs))
+
+if __name__ == "__main__":
+
+  # Set logging format, default level, etc.
+  logging.basicConfig(format="%(levelname)s: %(message)s", level=logging.INFO)
+
+  parser = argparse.ArgumentParser(description="Per test iteration coverage database")
+  parser.add_argument("-d", "--db", help="Coverage database file (default: coverage.db in the results folder, or here)")
+  subparsers = parser.add_subparsers(dest="command", required=True)
+
+  build_parser = subparsers.add_parser("build", help="Load the coverage of the dispatcher results")
+  build_parser.add_argument("ResultsPath", help="Dispatcher OutPath")
+  build_parser.add_argument("--prune", action="store_true", help="Drop the runs the manifest no longer lists")
+
+  covers_parser = subparsers.add_parser("covers", help="List the iterations that execute a source line")
+  covers_parser.add_argument("File", help="Source file, or the end of its path (e.g., FchAb.c)")
+  covers_parser.add_argument("Line", type=int, help="Line number")
+  covers_parser.add_argument("--branches", action="store_true", help="Match iterations taking a branch of the line instead")
+
+  unique_parser = subparsers.add_parser("unique", help="List the lines only a test covers")
+  unique_parser.add_argument("Test", help="Test name")
+  unique_parser.add_argument("-i", "--iteration", help="Only this iteration of the test")
+
+  subparsers.add_parser("stats", help="Print the combined line coverage of every source file")
+
+  args = parser.parse_args()
+
+  db_file = args.db
+  if db_file is None:
+    db_file = os.path.join(args.ResultsPath if args.command == "build" else os.getcwd(), COVERAGE_DB_FILE)
+  if args.command != "build" and not os.path.isfile(db_file):
+    logging.error("Coverage database (i.e., {}) does not exist.".format(db_file))
+    sys.exit(1)
+  db = UtCoverageDb(db_file)
+
+  start = time.monotonic()
+  if args.command == "build":
+    ut_build(db, args.ResultsPath, args.prune)
+  elif args.command == "covers":
+    ut_covers(db, args.File, args.Line, args.branches)
+  elif args.command == "unique":
+    ut_unique(db, args.Test, args.iteration)
+  else:
+    ut_stats(db)
+  logging.debug("{} done in {:.3f}s.".format(args.command, time.monotonic() - start))
@@ -0,0 +1,210 @@
+# Copyright 2024 Advanced Micro Devices, Inc. All rights reserved.
+# SPDX-License-Identifier: MIT
+
+"""
+Merges lcov coverage info files, for the coverage report tool and the
+combined coverage report of the test dispatcher.
+"""
+
+import os
+import heapq
+import logging
+import tempfile
+import itertools
+
+# Files merged at once; more are merged in batches through temporary files.
+MERGE_MAX_OPEN_FILES=256
+# Merge order of the lcov records of a source file
+LCOV_FN=0
+LCOV_FNDA=1
+LCOV_BRDA=2
+LCOV_DA=3
+
+def ut_lcov_sort_field (field):
+  # Orders numeric fields by value and keeps other fields comparable.
+  return (len(field), field)
+
+class UtLcovOrderError(Exception):
+  """
+  Raised when the records of an lcov file are not in merge key order.
+  """
+  def __init__(self, file):
+    super().__init__("{} is not in merge key order".format(file))
+    self.file = file
+
+def ut_read_lcov_stream (file):
+  """
+  Yields the FN, FNDA, BRDA and DA records of an lcov file in input order,
+  as (key, source file, value). Keys follow the lcov record order (source
+  file, record type, line number, ...), so the records of several files can
+  be merged on them. Summary records (FNF, LF, ...) are recomputed by the
+  merge and skipped.
+
+  FNDA records are keyed on the line of their function and follow no order
+  of their own: they are the only ones held back, until the FN records of
+  their source file have been read.
+  """
+  src_file = None
+  fn_lines = {}
+  fnda     = []
+
+  def flush_fnda ():
+    records = [((src_key, LCOV_FNDA, fn_lines.get(name, 0), name), src_file, count) for name, count in fnda]
+    fnda.clear ()
+    return sorted (records, key=lambda record: record[0])
+
+  with open (file, 'r') as fp:
+    for line in fp:
+      line = line.strip()
+      if line.startswith("SF:"):
+        src_file = line[3:]
+        src_key  = src_file.replace("\\", "/").lower()
+        fn_lines.clear ()
+        fnda.clear ()
+        continue
+      if line == "end_of_record":
+        if src_file is not None:
+          yield from flush_fnda ()
+        src_file = None
+        continue
+      if src_file is None or ":" not in line:
+        continue
+      tag, data = line.split(":", 1)
+      try:
+        if tag == "DA":
+          fields = data.split(",")
+          record = ((src_key, LCOV_DA, int(fields[0])), src_file, int(fields[1]))
+        elif tag == "FN":
+          number, name = data.split(",", 1)
+          fn_lines[name] = int(number)
+          record = ((src_key, LCOV_FN, int(number), name), src_file, name)
+        elif tag == "FNDA":
+          count, name = data.split(",", 1)
+          fnda.append ((name, int(count)))
+          continue
+        elif tag == "BRDA":
+          number, block, branch, taken = data.split(",", 3)
+          record = ((src_key, LCOV_BRDA, int(number), ut_lcov_sort_field(block), ut_lcov_sort_field(branch)), src_file, taken)
+        else:
+          continue
+      except ValueError:
+        logging.warning("Skipping malformed record '{}' in {}.".format(line, file))
+        continue
+      if fnda:
+        yield from flush_fnda ()
+      yield record
+
+def ut_read_lcov_records (file):
+  """
+  Yields the records of an lcov file (see ut_read_lcov_stream) one at a
+  time, for the merge. ut_filter_lcov and drcov2lcov write them in key
+  order; UtLcovOrderError is raised at the first record that is not (e.g.,
+  source files sorted case-sensitively), so that the file can be merged
+  with ut_read_lcov_sorted instead.
+  """
+  last_key = None
+  for record in ut_read_lcov_stream (file):
+    if last_key is not None and record[0] < last_key:
+      raise UtLcovOrderError (file)
+    last_key = record[0]
+    yield record
+
+def ut_read_lcov_sorted (file):
+  """
+  Yields the records of an lcov file sorted by key, which takes reading the
+  whole file first.
+  """
+  yield from sorted (ut_read_lcov_stream (file), key=lambda record: record[0])
+
+def ut_merge_coverage_info_files (files, out_file):
+  """
+  k-way merges lcov files into out_file, streaming one record per file at a
+  time. Hit counts of records with the same key (DA line, FNDA function,
+  BRDA branch) are summed; records found in some files only are kept, so
+  the files do not need the same instrumented lines.
+
+  A file found out of key order is read sorted and the merge starts over.
+  """
+  unordered = set()
+  while True:
+    readers = [ut_read_lcov_sorted (file) if file in unordered else ut_read_lcov_records (file) for file in files]
+    try:
+      ut_write_lcov_merge (readers, out_file)
+      return
+    except UtLcovOrderError as error:
+      logging.info("{}: sorting it.".format(error))
+      unordered.add (error.file)
+
+def ut_write_lcov_merge (readers, out_file):
+  """
+  Writes the merge of lcov record streams, each in key order, to out_file.
+  """
+  src_file = None
+  section  = None
+  found = hit = 0
+
+  def close_section (fp):
+    if section in (LCOV_FN, LCOV_FNDA):
+      fp.write ("FNF:{}\nFNH:{}\n".format(found, hit))
+    elif section == LCOV_BRDA:
+      fp.write ("BRF:{}\nBRH:{}\n".format(found, hit))
+    elif section == LCOV_DA:
+      fp.write ("LF:{}\nLH:{}\n".format(found, hit))
+
+  records = heapq.merge (*readers, key=lambda record: record[0])
+  with open (out_file, 'w') as fp:
+    for key, group in itertools.groupby (records, key=lambda record: record[0]):
+      group = list (group)
+      if key[0] != (src_file[0] if src_file else None):
+        if src_file is not None:
+          close_section (fp)
+          fp.write ("end_of_record\n")
+        src_file = (key[0], group[0][1])
+        section  = None
+        fp.write ("SF:{}\n".format(src_file[1]))
+      rank = key[1]
+      # FN and FNDA records share the function summary.
+      if rank != section and not (section == LCOV_FN and rank == LCOV_FNDA):
+        close_section (fp)
+        found = hit = 0
+      section = rank
+
+      if rank == LCOV_FN:
+        fp.write ("FN:{},{}\n".format(key[2], key[3]))
+        found += 1
+      elif rank == LCOV_FNDA:
+        count = sum (record[2] for record in group)
+        fp.write ("FNDA:{},{}\n".format(count, key[3]))
+        hit += 1 if count > 0 else 0
+      elif rank == LCOV_BRDA:
+        taken = [record[2] for record in group if record[2] != "-"]
+        taken = str (sum (int (count) for count in taken)) if taken else "-"
+        fp.write ("BRDA:{},{},{},{}\n".format(key[2], key[3][1], key[4][1], taken))
+        found += 1
+        hit += 1 if taken not in ("-", "0") else 0
+      else:
+        count = sum (record[2] for record in group)
+        fp.write ("DA:{},{}\n".format(key[2], count))
+        found += 1
+        hit += 1 if count > 0 else 0
+
+    if src_file is not None:
+      close_section (fp)
+      fp.write ("end_of_record\n")
+
+def ut_combine_coverage_info_files (files, out_file):
+  """
+  Merges the .coverage.info files of a source file into out_file, in
+  batches of MERGE_MAX_OPEN_FILES so that the open files stay bounded.
+  """
+  if len(files) <= MERGE_MAX_OPEN_FILES:
+    ut_merge_coverage_info_files (files, out_file)
+    return
+
+  with tempfile.TemporaryDirectory (dir=os.path.dirname(out_file)) as tmp_dir:
+    partials = []
+    for start in range (0, len(files), MERGE_MAX_OPEN_FILES):
+      partial = os.path.join (tmp_dir, "{}.info".format(len(partials)))
+      ut_merge_coverage_info_files (files[start:start + MERGE_MAX_OPEN_FILES], partial)
+      partials.append (partial)
+    ut_combine_coverage_info_files (partials, out_file)
@@ -0,0 +1,196 @@
+# Copyright 2024 Advanced Micro Devices, Inc. All rights reserved.
+# SPDX-License-Identifier: MIT
+
+import os
+import sys
+import json
+import heapq
+import logging
+import argparse
+
+from covdb import UtCoverageDb, ALL_ITERATIONS, COVERAGE_DB_FILE
+
+HISTORY_FILE="dispatcher_history.json"
+
+def ut_get_profile_tests(configs):
+  """
+  Returns the platform of the dispatcher test profile, and its components as
+  [(component name, [test entry])], nested profiles included.
+  """
+  with open(configs["TestProfile"]) as fp:
+    items = json.load(fp)
+  if "Platform" not in items[0]:
+    logging.error("Unknown test 'Platform'. Test profile header must indicate the 'Platform' field.")
+    sys.exit(1)
+  platform = items[0]["Platform"]
+
+  components = {}
+  profiles = [configs["TestProfile"]]
+  for profile in profiles:
+    with open(profile) as fp:
+      items = json.load(fp)
+    for item in items[0].get("Include", []):
+      profiles.append(os.path.join(configs["RepoPath"], item))
+    for component in items[1:]:
+      components.setdefault(component["Component"], []).extend(component["Tests"])
+  return platform, list(components.items())
+
+def ut_popcount(bitmap):
+  return bin(bitmap).count("1")
+
+class UtCandidate():
+  """
+  Unit the minimization keeps or drops: one iteration of a test, or all of
+  them when the coverage was collected per test.
+  """
+  def __init__(self, test, iterations, duration):
+    self.test       = test
+    self.iterations = iterations
+    self.duration   = duration
+    self.coverage   = {}    # file id: (line hit, branch hit)
+
+  def gain(self, covered):
+    """
+    Number of lines and branches covered by the candidate and not yet by the
+    selection.
+    """
+    gain = 0
+    for file_id, (lines, branches) in self.coverage.items():
+      covered_lines, covered_branches = covered.get(file_id, (0, 0))
+      gain += ut_popcount(lines & ~covered_lines) + ut_popcount(branches & ~covered_branches)
+    return gain
+
+def ut_get_candidates(db, tests, durations):
+  """
+  Returns the candidates of the profile tests found in the coverage database,
+  and the (test, iteration) it has no coverage of.
+  """
+  candidates = {}
+  for test in tests.values():
+    for iteration in test["Iterations"]:
+      key = "{}/{}".format(test["Name"], iteration)
+      # Without history, assume the worst: the iteration runs until its timeout.
+      candidates[(test["Name"], iteration)] = UtCandidate(test["Name"], [iteration], durations.get(key, test["Timeout"]))
+
+  runs = {}
+  for run_id, test, iteration in db.runs():
+    if test not in tests:
+      continue
+    if iteration == ALL_ITERATIONS:
+      iterations = tests[test]["Iterations"]
+      for _iteration in iterations:
+        candidates.pop((test, _iteration), None)
+      duration = sum(durations.get("{}/{}".format(test, _iteration), tests[test]["Timeout"]) for _iteration in iterations)
+      candidates[(test, iteration)] = UtCandidate(test, iterations, duration)
+    if (test, iteration) in candidates:
+      runs[run_id] = candidates[(test, iteration)]
+
+  for run_id, file_id, line_hit, _, branch_hit, _ in db.coverage():
+    if run_id in runs:
+      runs[run_id].coverage[file_id] = (line_hit, branch_hit)
+
+  measured = list(dict.fromkeys(runs.values()))
+  unmeasured = set((candidate.test, iteration) for candidate in candidates.values() if candidate not in measured
+    for iteration in candidate.iterations)
+  return measured, unmeasured
+
+def ut_minimize(candidates):
+  """
+  Greedy set cover: repeatedly keeps the candidate adding the most lines and
+  branches to the coverage of the selection, the shortest one on a tie,
+  until no candidate adds any. Gains only shrink as the selection grows, so
+  they are recomputed lazily, when a candidate comes first in the queue.
+  """
+  covered = {}
+  selected = []
+  queue = [(-candidate.gain(covered), candidate.duration, index) for index, candidate in enumerate(candidates)]
+  heapq.heapify(queue)
+  while queue:
+    gain, duration, index = heapq.heappop(queue)
+    if gain == 0:
+      break
+    candidate = candidates[index]
+    current = candidate.gain(covered)
+    if current != -gain:
+      heapq.heappush(queue, (-current, duration, index))
+      continue
+    selected.append(candidate)
+    for file_id, (lines, branches) in candidate.coverage.items():
+      covered_lines, covered_branches = covered.get(file_id, (0, 0))
+      covered[file_id] = (covered_lines | lines, covered_branches | branches)
+  return selected, covered
+
+def ut_write_profile(out_file, platform, components, selected, unmeasured):
+  """
+  Writes the profile of the selected iterations, plus the iterations without
+  coverage, in the dispatcher test profile format.
+  """
+  kept = {}
+  for candidate in selected:
+    kept.setdefault(candidate.test, set()).update(candidate.iterations)
+  for test, iteration in unmeasured:
+    kept.setdefault(test, set()).add(iteration)
+
+  profile = [{"Platform": platform, "Include": []}]
+  for name, tests in components:
+    _tests = []
+    for test in tests:
+      if test["Name"] in kept:
+        _test = dict(test)
+        _test["Iterations"] = [iteration for iteration in test["Iterations"] if iteration in kept[test["Name"]]]
+        _tests.append(_test)
+    if _tests:
+      profile.append({"Component": name, "Tests": _tests})
+
+  with open(out_file, 'w') as fp:
+    json.dump(profile, fp, indent=2)
+
+if __name__ == "__main__":
+
+  # Set logging format, default level, etc.
+  logging.basicConfig(format="%(levelname)s: %(message)s", level=logging.INFO)
+
+  parser = argparse.ArgumentParser(description="Derives the smallest test profile keeping the line and branch coverage")
+  parser.add_argument("ConfigFile", help="Dispatcher config file of the full run")
+  parser.add_argument("OutFile", help="Test profile to write")
+  parser.add_argument("-d", "--db", help="Coverage database file (default: coverage.db in the dispatcher OutPath)")
+  args = parser.parse_args()
+
+  with open(args.ConfigFile) as fp:
+    configs = json.load(fp)
+  for param in ["OutPath", "RepoPath", "TestProfile"]:
+    if param not in configs:
+      logging.error("Configuration parameter '{}' not found. '{}' parameter is mandatory.".format(param, param))
+      sys.exit(1)
+
+  db_file = args.db if args.db is not None else os.path.join(configs["OutPath"], COVERAGE_DB_FILE)
+  if not os.path.isfile(db_file):
+    logging.error("Coverage database (i.e., {}) does not exist. Build it with covdb.py first.".format(db_file))
+    sys.exit(1)
+  db = UtCoverageDb(db_file)
+
+  durations = {}
+  history_file = configs.get("HistoryFile") or \
+    os.path.join(os.path.dirname(os.path.abspath(configs["OutPath"])), HISTORY_FILE)
+  if os.path.isfile(history_file):
+    with open(history_file) as fp:
+      durations = json.load(fp)
+  else:
+    logging.warning("No duration history (i.e., {}). Test timeouts are used instead.".format(history_file))
+
+  platform, components = ut_get_profile_tests(configs)
+  tests = {test["Name"]: test for _, _tests in components for test in _tests}
+  candidates, unmeasured = ut_get_candidates(db, tests, durations)
+  for test, iteration in sorted(unmeasured):
+    logging.warning("No coverage of {}/{} in the database. Iteration kept.".format(test, iteration))
+
+  selected, covered = ut_minimize(candidates)
+  ut_write_profile(args.OutFile, platform, components, selected, unmeasured)
+
+  lines = sum(ut_popcount(lines) for lines, _ in covered.values())
+  branches = sum(ut_popcount(branches) for _, branches in covered.values())
+  logging.info("{} of {} measured iteration(s) kept, covering {} line(s) and {} branch(es).".format(
+    sum(len(candidate.iterations) for candidate in selected), sum(len(candidate.iterations) for candidate in candidates),
+    lines, branches))
+  logging.info("Estimated duration: {:.1f}s of {:.1f}s.".format(
+    sum(candidate.duration for candidate in selected), sum(candidate.duration for candidate in candidates)))
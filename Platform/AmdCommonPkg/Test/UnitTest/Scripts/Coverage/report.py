@@ -7,14 +7,26 @@ import json
 import glob
 import time
 import shutil
+import hashlib
 import logging
 import argparse
 import subprocess
+import concurrent.futures
 
+import pygount
 from pygount import SourceAnalysis
 from mako.lookup import TemplateLookup
 
+from lcovmerge import ut_combine_coverage_info_files
+
 REPORT_INDEX_HTML="report.html"
+# Written by the dispatcher in its OutPath (i.e., InPath)
+COVERAGE_MANIFEST_FILE="coverage_manifest.json"
+# genhtml output folder of a component, next to the per-file folders
+COMPONENT_HTML_DIR="html"
+SOURCE_ANALYSIS_CACHE_FILE="pygount_cache.json"
+# Cached analyses not used for this long are dropped
+SOURCE_ANALYSIS_CACHE_MAX_AGE=30 * 24 * 3600
 
 script_dir = os.path.dirname(os.path.abspath(sys.argv[0]))
 
@@ -41,6 +53,7 @@ class SrcFile():
     self.coverage   = 0
     self.empty_cnt  = 0
     self.string_cnt = 0
+    self.combined   = None
 
 class Component():
   """
@@ -77,7 +90,7 @@ def ut_get_all_components(top_src_file):
   """
   """
   src_files = []
-  all_components = []
+  all_components = {}    # By name, in source list order
   repo_path = configs["RepoPath"]
 
   src_files.append(top_src_file)
@@ -120,20 +133,44 @@ def ut_get_all_components(top_src_file):
         src_file.name = os.path.basename(file["Name"]).replace(".c", "").replace(".C", "")
         component.soc_files.append(src_file)
 
-      if component in all_components:
-        existing_component = all_components[all_components.index(component)] # Get the existing component
+      if component.name in all_components:
+        existing_component = all_components[component.name] # Get the existing component
         existing_component.cmn_files.extend(component.cmn_files) # Add the files to the existing component
         existing_component.soc_files.extend(component.soc_files) # Add the files to the existing component
       else:
-        all_components.append(component)
+        all_components[component.name] = component
+
+  return list(all_components.values())
 
-  return all_components
+def ut_coverage_info_name(src_file_path):
+  _name = os.path.basename(src_file_path.strip().replace("\\", "/"))
+  return _name.replace(".c", "").replace(".C", "")
 
 def ut_collect_coverage_infos(configs):
   """
+  Returns the coverage info files of the test results by target file name.
+  They are listed by the dispatcher coverage manifest; results without one
+  are searched for.
   """
-  coverage_infos = []
-  files = glob.glob (configs["InPath"]+ "\**\*.coverage.info", recursive=True)
+  coverage_infos = {}
+
+  def add(name, file):
+    if name not in coverage_infos:
+      coverage_infos[name] = CoverageInfo()
+      coverage_infos[name].target_file = name
+    coverage_infos[name].paths.append(file)
+
+  manifest_file = os.path.join(configs["InPath"], COVERAGE_MANIFEST_FILE)
+  if os.path.isfile(manifest_file):
+    with open(manifest_file) as fp:
+      manifest = json.load(fp)
+    for target_file, entries in manifest["Targets"].items():
+      for entry in entries:
+        add(ut_coverage_info_name(target_file), os.path.join(configs["InPath"], entry["Path"]))
+    return coverage_infos
+
+  logging.warning("No {} in {}: searching for coverage info files.".format(COVERAGE_MANIFEST_FILE, configs["InPath"]))
+  files = glob.glob (os.path.join(configs["InPath"], "**", "*.coverage.info"), recursive=True)
 
   for file in files:
     first_line = ""
@@ -143,140 +180,216 @@ def ut_collect_coverage_infos(configs):
       continue
     elif first_line[0:3] != "SF:":
       continue
-    else:
-      pass
-    coverage_info = CoverageInfo()
-    _name = os.path.basename(first_line[3:].strip())
-    _name = _name.replace(".c", "").replace(".C", "")
-    coverage_info.target_file = _name
-
-    if coverage_info not in coverage_infos:
-      coverage_info.paths.append(file)
-      coverage_infos.append(coverage_info)
-    else:
-      idx = coverage_infos.index(coverage_info)
-      coverage_infos[idx].paths.append(file)
+    add(ut_coverage_info_name(first_line[3:]), file)
 
   return coverage_infos
 
-def ut_combine_coverage_info_files (files):
+def ut_get_genhtml(configs):
   """
+  Returns the genhtml command: the one of DynamoRio for drcov results, the
+  lcov one otherwise (see CoverageBackend in the dispatcher).
   """
-  # This function is a bit complicated.
-
-  _all_lines = []
-  combined_cov_info_lines = []
-
-  for file in files:
-    with open (file, 'r') as fp:
-      lines = fp.readlines()
-    _all_lines.append(lines)
-
-  line_cnt = len(_all_lines[0])
-  for lines in _all_lines:
-    if len(lines) != line_cnt:
-      # This is a fatal issue
-      logging.error("Different # of lines found in .coverage.info files of the same src file.")
-      logging.error ("{} != {}".format(len(lines), line_cnt))
-      sys.exit(1)
-
-  line0 = _all_lines[0][0]
-  for lines in _all_lines:
-    if lines[0] != line0:
-      # This is a fatal issue
-      logging.error("Different opening line found in .coverage.info files of the same src file.")
-      logging.error ("{} != {}".format(lines[0], line0))
-      sys.exit(1)
-
-  last_line = _all_lines[0][-1]
-  for lines in _all_lines:
-    if lines[-1] != last_line:
-      # This is a fatal issue
-      logging.error("Different closing line found in .coverage.info files of the same src file.")
-      logging.error ("{} != {}".format(lines[-1], last_line))
-      sys.exit(1)
-
-  combined_cov_info_lines.append(line0)
+  if configs.get("CoverageBackend", "drcov") == "drcov":
+    perl = os.path.join(configs["PerlPath"], "perl.exe")
+    return [perl, os.path.join(configs["DynamoRioPath"], "tools\\bin32\\genhtml")]
+  return [configs.get("GenHtml", "genhtml")]
 
-  for line_index in range (1, line_cnt-1):
-    _str0 = []
-    _str1 = []
-    for lines in _all_lines:
-      a, b = lines[line_index].split(",")
-      _str0.append(a)
-      _str1.append(int(b))
-    combined_cov_info_lines.append ("{},{}\n".format(_str0[0], str(max(_str1))))
-
-  combined_cov_info_lines.append(last_line)
-
-  return combined_cov_info_lines
-
-def ut_create_file_report (configs, coverage_infos, component_outpath, src_file):
+def ut_lcov_rate (lcov_file):
   """
+  Returns the line coverage of an lcov file formatted like genhtml does
+  (one decimal, never rounded to 0.0 or 100.0 unless exact), or None.
+  """
+  found = 0
+  hit   = 0
+  with open (lcov_file, 'r') as fp:
+    for line in fp:
+      if line.startswith("DA:"):
+        found += 1
+        if int(line[3:].split(",")[1]) > 0:
+          hit += 1
+  if found == 0:
+    return None
+  rate = "{:.1f}".format(100.0 * hit / found)
+  if rate == "100.0" and hit < found:
+    rate = "99.9"
+  elif rate == "0.0" and hit > 0:
+    rate = "0.1"
+  return rate
+
+class SourceAnalysisCache():
+  """
+  pygount line counts of source files by content hash, kept across report
+  runs: an unchanged file is not analyzed again, a changed one misses.
+  Counts of another pygount version are discarded.
+  """
+  def __init__ (self, path):
+    self.path    = path
+    self.entries = {}
+    if os.path.isfile(path):
+      try:
+        with open(path, 'r') as fp:
+          cache = json.load(fp)
+        if cache.get("Version") == pygount.__version__:
+          self.entries = cache["Files"]
+      except (ValueError, KeyError):
+        logging.warning("Ignoring corrupted source analysis cache {}.".format(path))
+
+  @staticmethod
+  def key (src_file_abs_path):
+    digest = hashlib.sha256()
+    with open(src_file_abs_path, 'rb') as fp:
+      digest.update(fp.read())
+    return digest.hexdigest()
+
+  def get (self, key):
+    entry = self.entries.get(key)
+    if entry is None:
+      return None
+    entry["LastUsed"] = time.time()
+    return entry["Counts"]
+
+  def put (self, key, counts):
+    self.entries[key] = {"Counts": counts, "LastUsed": time.time()}
+
+  def save (self):
+    now = time.time()
+    entries = {key: entry for key, entry in self.entries.items() if now - entry["LastUsed"] < SOURCE_ANALYSIS_CACHE_MAX_AGE}
+    with open(self.path, 'w') as fp:
+      json.dump({"Version": pygount.__version__, "Files": entries}, fp)
+
+def ut_create_file_report (configs, coverage_paths, report_dir, src_file_path, counts=None):
+  """
+  Analyzes a source file, unless its line counts are given (cached), and
+  merges its coverage info in report_dir. Runs in a report worker process:
+  returns the source line counts, the combined coverage info file (or None)
+  and the coverage percentage.
   """
-  perl = os.path.join(configs["PerlPath"], "perl.exe")
-  genhtml = os.path.join(configs["DynamoRioPath"], "tools\\bin32\genhtml")
-
   # Get file line and src code line counts
-  src_file_abs_path = os.path.join(configs["RepoPath"], src_file.path)
-
-  analysis = SourceAnalysis.from_file(src_file_abs_path, 'pygount')
-  src_file.code_cnt   = analysis.code_count
-  src_file.doc_cnt    = analysis.documentation_count
-  src_file.empty_cnt  = analysis.empty_count
-  src_file.string_cnt = analysis.string_count
+  src_file_abs_path = os.path.join(configs["RepoPath"], src_file_path)
+
+  if counts is None:
+    analysis = SourceAnalysis.from_file(src_file_abs_path, 'pygount')
+    counts = [analysis.code_count, analysis.documentation_count, analysis.empty_count, analysis.string_count]
+  result = {
+    "counts"     : counts,
+    "code_cnt"   : counts[0],
+    "doc_cnt"    : counts[1],
+    "empty_cnt"  : counts[2],
+    "string_cnt" : counts[3],
+    "combined"   : None,
+    "coverage"   : 0,
+  }
 
   # Make src file report folder
-  report_dir = os.path.join(component_outpath, src_file.name)
   if not os.path.isdir(report_dir):
     os.mkdir(report_dir)
 
-  coverage_info = None
-  for _coverage_info in coverage_infos:
-    if _coverage_info.target_file == src_file.name:
-      coverage_info = _coverage_info
-      break
-
-  if coverage_info is None:
-    return
+  if not coverage_paths:
+    return result
 
-  combined_cov_info_file =  os.path.join(report_dir, "{}.combined.coverage.info".format(src_file.name))
-  if (len(coverage_info.paths) == 1):
-    shutil.copy (coverage_info.paths[0], combined_cov_info_file)
+  name = os.path.basename(report_dir)
+  combined_cov_info_file =  os.path.join(report_dir, "{}.combined.coverage.info".format(name))
+  if (len(coverage_paths) == 1):
+    shutil.copy (coverage_paths[0], combined_cov_info_file)
   else:
-    combined_cov_info_str = ut_combine_coverage_info_files (coverage_info.paths)
-    with open (combined_cov_info_file, "w") as fp:
-      for line in combined_cov_info_str:
-        fp.write (line)
+    ut_combine_coverage_info_files (coverage_paths, combined_cov_info_file)
 
-  logging.debug("Running {} {} {} -o {}".format(perl, genhtml, combined_cov_info_file, report_dir))
-  ret = subprocess.run([perl, genhtml, combined_cov_info_file, "-o", report_dir], stdout=subprocess.PIPE)
-  if ret.returncode != 0:
-    logging.error("genhtml for {} failed (returncode: {})".format(combined_cov_info_file, ret.returncode))
+  rate = ut_lcov_rate (combined_cov_info_file)
+  if rate is None:
+    logging.error("No line coverage found in {}.".format(combined_cov_info_file))
+    return result
+  result["combined"] = combined_cov_info_file
+  result["coverage"] = rate
+  return result
 
-  stdout_str = str(ret.stdout)
-  index0 = stdout_str.find("lines......: ")
-  if (index0 == -1):
-    logging.error("Failed to parse coverage information from generated html file. This should not happen!")
+def ut_create_component_report (configs, component_outpath, src_files):
+  """
+  Renders the coverage of all files of a component with one genhtml run,
+  and links each file folder (<Component>/<File>/index.html) to its page.
+  """
+  src_files = [src_file for src_file in src_files if src_file.combined is not None]
+  if not src_files:
     return
-  index1 = stdout_str[index0+13:].find("%")
-  if (index1 == -1):
-    logging.error("Failed to parse coverage information from generated html file. This should not happen!")
+
+  # The combined files cover distinct sources: their records concatenate into one tracefile.
+  html_dir = os.path.join(component_outpath, COMPONENT_HTML_DIR)
+  component_cov_info_file = os.path.join(component_outpath, "component.coverage.info")
+  with open (component_cov_info_file, 'w') as out:
+    for src_file in src_files:
+      with open (src_file.combined, 'r') as fp:
+        shutil.copyfileobj (fp, out)
+
+  genhtml = ut_get_genhtml(configs)
+  logging.debug("Running {} {} -o {}".format(" ".join(genhtml), component_cov_info_file, html_dir))
+  ret = subprocess.run(genhtml + [component_cov_info_file, "-o", html_dir], stdout=subprocess.PIPE)
+  if ret.returncode != 0:
+    logging.error("genhtml for {} failed (returncode: {})".format(component_cov_info_file, ret.returncode))
     return
 
-  src_file.coverage = stdout_str[index0+13:index0+13+index1]
+  # genhtml names a source page <file>.gcov.html, in a folder named after the source folder.
+  pages = {}
+  for root, _, names in os.walk(html_dir):
+    for page in names:
+      if page.endswith(".gcov.html"):
+        pages.setdefault(page[:-len(".gcov.html")].lower(), []).append(os.path.join(root, page))
 
-def ut_update_lcov_reports(configs, coverage_infos, components):
+  for src_file in src_files:
+    candidates = pages.get(os.path.basename(src_file.path.replace("\\", "/")).lower(), [])
+    src_dir = os.path.dirname(src_file.path.replace("\\", "/")).lower()
+    candidates = sorted(candidates, key=lambda page: not src_dir.endswith(
+      os.path.relpath(os.path.dirname(page), html_dir).replace("\\", "/").lower()))
+    if not candidates:
+      logging.error("genhtml produced no page for {}.".format(src_file.path))
+      continue
+    report_dir = os.path.join(component_outpath, src_file.name)
+    target = os.path.relpath(candidates[0], report_dir).replace("\\", "/")
+    with open (os.path.join(report_dir, "index.html"), 'w') as fp:
+      fp.write('<html><head><meta http-equiv="refresh" content="0; url={0}"/></head>'
+        '<body><a href="{0}">{0}</a></body></html>\n'.format(target))
+
+def ut_update_lcov_reports(configs, coverage_infos, components, analysis_cache=None):
   """
+  Creates the file reports of all components on a pool of worker processes
+  (source analysis and coverage merges are CPU bound), then one genhtml
+  run per component. Source files found in analysis_cache are not
+  analyzed again.
   """
   out_path = configs["OutPath"]
-  for component in components:
-    component_outpath = os.path.join(out_path, component.name)
-    if not os.path.isdir(component_outpath):
-      os.mkdir(component_outpath)
-    src_files = component.cmn_files + component.soc_files
-    for src_file in src_files:
-      ut_create_file_report (configs, coverage_infos, component_outpath, src_file)
+  coverage_paths = {name: coverage_info.paths for name, coverage_info in coverage_infos.items()}
+  jobs = configs.get("ReportJobs") or os.cpu_count() or 1
+  keys = {}
+
+  with concurrent.futures.ProcessPoolExecutor(max_workers=jobs) as executor:
+    futures = {}
+    for component in components:
+      component_outpath = os.path.join(out_path, component.name)
+      if not os.path.isdir(component_outpath):
+        os.mkdir(component_outpath)
+      for src_file in component.cmn_files + component.soc_files:
+        report_dir = os.path.join(component_outpath, src_file.name)
+        counts = None
+        if analysis_cache is not None:
+          keys[src_file] = SourceAnalysisCache.key(os.path.join(configs["RepoPath"], src_file.path))
+          counts = analysis_cache.get(keys[src_file])
+        future = executor.submit(ut_create_file_report, configs, coverage_paths.get(src_file.name, []), report_dir, src_file.path, counts)
+        futures[future] = src_file
+
+    for future in concurrent.futures.as_completed(futures):
+      src_file = futures[future]
+      result = future.result()
+      src_file.code_cnt   = result["code_cnt"]
+      src_file.doc_cnt    = result["doc_cnt"]
+      src_file.empty_cnt  = result["empty_cnt"]
+      src_file.string_cnt = result["string_cnt"]
+      src_file.combined   = result["combined"]
+      src_file.coverage   = result["coverage"]
+      if analysis_cache is not None:
+        analysis_cache.put(keys[src_file], result["counts"])
+
+  with concurrent.futures.ThreadPoolExecutor(max_workers=jobs) as executor:
+    for future in [executor.submit(ut_create_component_report, configs, os.path.join(out_path, component.name),
+                                   component.cmn_files + component.soc_files) for component in components]:
+      future.result()
 
 def ut_create_summary_report(configs, test_info, components):
   """
@@ -342,19 +455,21 @@ def ut_get_configs(config_file):
     logging.error("Repo directory (i.e., {}) does not exist.".format(configs["RepoPath"]))
     sys.exit(1)
 
-  if 'PerlPath' not in configs:
-    logging.error("Configuration parameter 'PerlPath' not found. 'PerlPath' parameter is mandatory.")
-    sys.exit(1)
-  if not os.path.isdir(configs["PerlPath"]):
-    logging.error("Perl directory (i.e., {}) does not exist.".format(configs["PerlPath"]))
-    sys.exit(1)
+  # DynamoRio and the Perl it runs genhtml with are only needed for drcov results.
+  if configs.get("CoverageBackend", "drcov") == "drcov":
+    if 'PerlPath' not in configs:
+      logging.error("Configuration parameter 'PerlPath' not found. 'PerlPath' parameter is mandatory.")
+      sys.exit(1)
+    if not os.path.isdir(configs["PerlPath"]):
+      logging.error("Perl directory (i.e., {}) does not exist.".format(configs["PerlPath"]))
+      sys.exit(1)
 
-  if 'DynamoRioPath' not in configs:
-    logging.error("Configuration parameter 'DynamoRioPath' not found. 'DynamoRioPath' parameter is mandatory.")
-    sys.exit(1)
-  if not os.path.isdir(configs["DynamoRioPath"]):
-    logging.error("DynamoRio directory (i.e., {}) does not exist.".format(configs["DynamoRioPath"]))
-    sys.exit(1)
+    if 'DynamoRioPath' not in configs:
+      logging.error("Configuration parameter 'DynamoRioPath' not found. 'DynamoRioPath' parameter is mandatory.")
+      sys.exit(1)
+    if not os.path.isdir(configs["DynamoRioPath"]):
+      logging.error("DynamoRio directory (i.e., {}) does not exist.".format(configs["DynamoRioPath"]))
+      sys.exit(1)
 
   if 'SrcFileList' not in configs:
     logging.error("Configuration parameter 'SrcFileList' not found. 'UnitTestSrcFileList' parameter is mandatory.")
@@ -405,8 +520,14 @@ if __name__ == "__main__":
   # Collect all available coverage info files
   coverage_infos = ut_collect_coverage_infos(configs)
 
+  # Line counts of the sources analyzed by previous runs
+  analysis_cache_file = configs.get("SourceAnalysisCache") or \
+    os.path.join(os.path.dirname(os.path.abspath(configs["OutPath"])), SOURCE_ANALYSIS_CACHE_FILE)
+  analysis_cache = SourceAnalysisCache(analysis_cache_file)
+
   #
-  ut_update_lcov_reports(configs, coverage_infos, components)
+  ut_update_lcov_reports(configs, coverage_infos, components, analysis_cache)
+  analysis_cache.save()
 
   #
   ut_create_summary_report(configs, test_info, components)
@@ -3,18 +3,47 @@
 
 import os
 import sys
+import re
 import json
+import time
+import queue
+import shutil
+import hashlib
 import logging
 import argparse
+import threading
 import traceback
 import subprocess
+import concurrent.futures
 
 from datetime import datetime
 from mako.lookup import TemplateLookup
 
+# The lcov merge of the coverage report tool
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "Coverage"))
+from lcovmerge import ut_combine_coverage_info_files
+
 AGESA="AGCL-R"
 JSON_EXTENSION=".json"
-BINARY_EXTENSION=".exe"
+HISTORY_FILE="dispatcher_history.json"
+CACHE_DIR="dispatcher_cache"
+CACHE_META_FILE="cache.json"
+CACHE_VERSION=2
+CACHE_DEFAULT_SIZE_MB=2048
+FAKE_IMAGE_KEY="FakeImage"
+IMPACT_MAP_FILE="dispatcher_impact.json"
+COVERAGE_BACKENDS=("drcov", "gcov", "llvm-cov")
+COVERAGE_REPORT_DIR="coverage"
+COVERAGE_MANIFEST_FILE="coverage_manifest.json"
+COVERAGE_MANIFEST_VERSION=1
+# Changes to these files may affect any test: they select every iteration.
+IMPACT_GLOBAL_EXTENSIONS=(".h", ".inf", ".dec", ".dsc", ".fdf")
+IMPACT_SOURCE_EXTENSIONS=(".c", ".cpp", ".s", ".asm", ".nasm")
+BINARY_EXTENSION=".exe" if os.name == "nt" else ""
+# Tests enforce their timeout themselves (-w) and exit with AMD_UNIT_TEST_TIMEOUT;
+# they are only killed if still running WATCHDOG_GRACE seconds later.
+WATCHDOG_GRACE=5
+TIMEOUT_RETURNCODE=4
 DISPATCHER_INDEX_HTML="dispatcher.html"
 OUI="AmdOpenSilPkg/opensil-uefi-interface"
 OPENSIL="{}/OpenSIL".format(OUI)
@@ -27,12 +56,15 @@ class Ut():
   def __init__(self):
     self.name         = None
     self.bin_path     = None
+    self.bin_args     = []
     self.out_path     = None
     self.timeout      = None
     self.target_file  = None
     self.status       = []
     self.coverage     = []
     self.iterations   = []
+    self.coverage_per_test = False
+    self.src_dir      = None
 
 class UtComponent():
   """
@@ -49,15 +81,13 @@ def get_git_revision_hash(path):
 
 def find_drcov_log(path):
 
-  files_full_path = [os.path.join(path, _file) for _file in os.listdir(path)]
-  lst = sorted(
-    filter(lambda x: (os.path.basename(x).startswith("drcov") and os.path.basename(x).endswith(".log")), files_full_path),
-    key=os.path.getmtime,
-  )
-  if not lst:
+  # Latest drcov log of the folder; only the drcov logs are looked at.
+  with os.scandir(path) as entries:
+    logs = [entry for entry in entries if entry.name.startswith("drcov") and entry.name.endswith(".log")]
+  if not logs:
     logging.error("Could not locate drcov output log in {}.".format(path))
     sys.exit(1)
-  return lst[-1]
+  return max(logs, key=lambda entry: entry.stat().st_mtime).path
 
 def get_test_status(result_file):
   status = None
@@ -67,65 +97,941 @@ def get_test_status(result_file):
       status = results["Status"]
   return status
 
-def ut_dispatch(configs, components):
+class UtWorker():
+  """
+  Test binary started with --worker, kept running to serve run requests.
+  """
+  def __init__(self, cmd, env=None):
+    self.next_id   = 0
+    self.responses = queue.Queue()
+    self.process   = subprocess.Popen(cmd, stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+      universal_newlines=True, bufsize=1, env=env)
+    self.reader    = threading.Thread(target=self._read, daemon=True)
+    self.reader.start()
+
+  def _read(self):
+    for line in self.process.stdout:
+      try:
+        self.responses.put(json.loads(line))
+      except ValueError:
+        logging.warning("Ignoring worker output line: {}".format(line.rstrip()))
+    self.responses.put(None)
+
+  def run(self, request, timeout):
+    """
+    Sends a run request and waits for its response. Raises
+    subprocess.TimeoutExpired if the response does not come in time.
+    """
+    self.next_id += 1
+    request["Id"] = self.next_id
+    self.process.stdin.write(json.dumps(request) + "\n")
+    self.process.stdin.flush()
+    while True:
+      try:
+        response = self.responses.get(timeout=timeout)
+      except queue.Empty:
+        raise subprocess.TimeoutExpired(self.process.args, timeout)
+      if response is None:
+        raise RuntimeError("Worker exited (returncode: {}).".format(self.process.wait()))
+      if response.get("Id") == request["Id"]:
+        return response
+
+  def close(self):
+    # The worker exits, and drrun writes its coverage log, once stdin is closed.
+    self.process.stdin.close()
+    self.process.wait()
+
+  def kill(self):
+    self.process.kill()
+    self.process.wait()
+
+class UtWorkerPool():
+  """
+  Warm test workers, at most max_workers per test binary command line.
+  """
+  def __init__(self, max_workers):
+    self.max_workers = max(1, max_workers)
+    self.idle        = {}
+    self.count       = {}
+    self.cond        = threading.Condition()
+
+  def run(self, cmd, request, timeout, env=None):
+    key = tuple(cmd)
+    with self.cond:
+      while not self.idle.get(key) and self.count.get(key, 0) >= self.max_workers:
+        self.cond.wait()
+      if self.idle.get(key):
+        worker = self.idle[key].pop()
+      else:
+        self.count[key] = self.count.get(key, 0) + 1
+        worker = None
+    try:
+      if worker is None:
+        worker = UtWorker(cmd, env)
+      response = worker.run(request, timeout)
+      if response.get("Status") == "TIMEOUT":
+        # The worker exits once it has answered a request that timed out.
+        worker.close()
+        with self.cond:
+          self.count[key] -= 1
+          self.cond.notify()
+        return response
+    except:
+      # A worker that missed a response is in an unknown state: replace it.
+      if worker is not None:
+        worker.kill()
+      with self.cond:
+        self.count[key] -= 1
+        self.cond.notify()
+      raise
+    with self.cond:
+      self.idle.setdefault(key, []).append(worker)
+      self.cond.notify()
+    return response
+
+  def close(self, cmd):
+    key = tuple(cmd)
+    with self.cond:
+      workers = self.idle.pop(key, [])
+      self.count[key] = self.count.get(key, 0) - len(workers)
+    for worker in workers:
+      worker.close()
+
+def ut_lcov_number(field):
+  # Orders the numeric fields of a record by value, others after them.
+  return (0, int(field), "") if field.isdigit() else (1, 0, field)
+
+def ut_filter_lcov(lcov_file, target_file, lcov_outfile):
+  """
+  Keeps the FN, FNDA, BRDA and DA records of the target file record, each
+  kind in line order (FNDA in the order of the FN records), in the lcov
+  record order: the layout drcov2lcov produces and report.py reads. Summary
+  records are left to the tools reading the file. Returns False if the
+  target file is not in lcov_file.
+  """
+  target = target_file.replace("\\", "/").lower()
+  found = False
+  with open(lcov_file) as fp, open(lcov_outfile, 'w') as out:
+    record = None
+    for line in fp:
+      line = line.strip()
+      if line.startswith("SF:"):
+        record = None
+        if line[3:].replace("\\", "/").lower().endswith(target):
+          record = {"FN": [], "FNDA": [], "BRDA": [], "DA": []}
+          out.write(line + "\n")
+      elif record is None:
+        continue
+      elif line == "end_of_record":
+        fn_lines = {name: number for number, name in record["FN"]}
+        for number, name in sorted(record["FN"]):
+          out.write("FN:{},{}\n".format(number, name))
+        for count, name in sorted(record["FNDA"], key=lambda fnda: (fn_lines.get(fnda[1], 0), fnda[1])):
+          out.write("FNDA:{},{}\n".format(count, name))
+        for fields in sorted(record["BRDA"], key=lambda fields: [ut_lcov_number(field) for field in fields[:3]]):
+          out.write("BRDA:{}\n".format(",".join(fields)))
+        for number, count in sorted(record["DA"]):
+          out.write("DA:{},{}\n".format(number, count))
+        out.write("end_of_record\n")
+        record = None
+        found = True
+      elif ":" in line:
+        tag, data = line.split(":", 1)
+        try:
+          if tag == "DA":
+            fields = data.split(",")
+            record["DA"].append((int(fields[0]), int(fields[1])))
+          elif tag == "FN":
+            number, name = data.split(",", 1)
+            record["FN"].append((int(number), name))
+          elif tag == "FNDA":
+            count, name = data.split(",", 1)
+            record["FNDA"].append((int(count), name))
+          elif tag == "BRDA" and len(data.split(",")) == 4:
+            record["BRDA"].append(data.split(","))
+        except ValueError:
+          logging.warning("Skipping malformed record '{}' in {}.".format(line, lcov_file))
+  return found
+
+def ut_remove_files(path, match):
+  # Removes the files of the folder whose name matches; sub-folders are left alone.
+  if os.path.isdir(path):
+    for entry in os.scandir(path):
+      if entry.is_file() and match(entry.name):
+        os.remove(entry.path)
 
-  drrun = os.path.join(configs["DynamoRioPath"], "bin32\\drrun.exe")
-  drcov2lcov = os.path.join(configs["DynamoRioPath"], "tools\\bin32\\drcov2lcov.exe")
-  perl = os.path.join(configs["PerlPath"], "perl.exe")
-  genhtml = os.path.join(configs["DynamoRioPath"], "tools\\bin32\genhtml")
+class UtCoverageBackend():
+  """
+  How test processes are instrumented, and how their coverage is turned
+  into <Test>.coverage.info (lcov), filtered to the test target file.
+  """
+  def __init__(self, configs):
+    self.configs = configs
+
+  def wrap(self, test, cmd, log_path):
+    """
+    Returns the command line and the environment variables to add to run
+    cmd with its coverage logs written in log_path.
+    """
+    return cmd, {}
+
+  def clean(self, test, log_path):
+    """
+    Removes the coverage logs an earlier run left in log_path, so that
+    export only sees those of the processes about to run.
+    """
+    pass
+
+  def export(self, test, log_path, lcov_outfile):
+    """
+    Writes the lcov of all processes logged in log_path. Returns False on
+    failure.
+    """
+    raise NotImplementedError
+
+  def genhtml(self):
+    return [self.configs.get("GenHtml", "genhtml")]
+
+class UtDrcovBackend(UtCoverageBackend):
+  """
+  DynamoRIO drcov: runs the test binary as built, under binary translation.
+  """
+  def wrap(self, test, cmd, log_path):
+    drrun = os.path.join(self.configs["DynamoRioPath"], "bin32\\drrun.exe")
+    return [drrun, "-t", "drcov", "-logdir", log_path, "--"] + cmd, {}
+
+  def clean(self, test, log_path):
+    ut_remove_files(log_path, lambda name: name.startswith("drcov") and name.endswith(".log"))
+
+  def export(self, test, log_path, lcov_outfile):
+    drcov2lcov = os.path.join(self.configs["DynamoRioPath"], "tools\\bin32\\drcov2lcov.exe")
+    if test.coverage_per_test:
+      drcov_args = ["-dir", log_path]
+    else:
+      drcov_args = ["-input", find_drcov_log(log_path)]
+    logging.debug("Running {} {} -output {} -src_filter {}".format(drcov2lcov, " ".join(drcov_args), lcov_outfile, test.target_file))
+    ret = subprocess.run([drcov2lcov] + drcov_args + ["-output", lcov_outfile, "-src_filter", test.target_file])
+    if ret.returncode != 0:
+      logging.error("Test {} drcov2lcov failed (returncode: {})".format(test.name, ret.returncode))
+      return False
+    return True
+
+  def genhtml(self):
+    perl = os.path.join(self.configs["PerlPath"], "perl.exe")
+    return [perl, os.path.join(self.configs["DynamoRioPath"], "tools\\bin32\\genhtml")]
+
+class UtGcovBackend(UtCoverageBackend):
+  """
+  GCC --coverage (build with -D UT_COVERAGE=GCOV): every test process,
+  forked iterations included, writes .gcda counters under log_path
+  (GCOV_PREFIX), where runs of the same binary add up, e.g., all
+  iterations served by a worker.
+  """
+  def wrap(self, test, cmd, log_path):
+    return cmd, {"GCOV_PREFIX": os.path.join(log_path, "gcda")}
+
+  def clean(self, test, log_path):
+    # Counters already in the folder would be added to.
+    shutil.rmtree(os.path.join(log_path, "gcda"), ignore_errors=True)
+
+  def export(self, test, log_path, lcov_outfile):
+    gcda_path = os.path.join(log_path, "gcda")
+    if not os.path.isdir(gcda_path):
+      logging.error("Test {} wrote no gcov counters in {}.".format(test.name, gcda_path))
+      return False
+    # gcov needs the notes files of the build next to the counters.
+    for root, _, names in os.walk(gcda_path):
+      for name in names:
+        if name.endswith(".gcda"):
+          gcno = os.path.join(os.sep, os.path.relpath(os.path.join(root, name[:-5] + ".gcno"), gcda_path))
+          if os.path.isfile(gcno):
+            shutil.copy(gcno, root)
+    raw_outfile = lcov_outfile + ".raw"
+    cmd = [self.configs.get("Lcov", "lcov"), "--capture", "--quiet", "--directory", gcda_path,
+      "--gcov-tool", self.configs.get("Gcov", "gcov"), "--output-file", raw_outfile]
+    logging.debug("Running {}".format(" ".join(cmd)))
+    ret = subprocess.run(cmd)
+    if ret.returncode != 0:
+      logging.error("Test {} lcov failed (returncode: {})".format(test.name, ret.returncode))
+      return False
+    found = ut_filter_lcov(raw_outfile, test.target_file, lcov_outfile)
+    os.remove(raw_outfile)
+    return found
+
+class UtLlvmCovBackend(UtCoverageBackend):
+  """
+  Clang -fprofile-instr-generate -fcoverage-mapping (build with
+  -D UT_COVERAGE=LLVM): every test process, forked iterations included,
+  writes a .profraw file in log_path; they are merged with llvm-profdata.
+  """
+  def wrap(self, test, cmd, log_path):
+    return cmd, {"LLVM_PROFILE_FILE": os.path.join(log_path, "{}-%p.profraw".format(test.name))}
 
+  def clean(self, test, log_path):
+    ut_remove_files(log_path, lambda name: name.endswith(".profraw"))
+
+  def export(self, test, log_path, lcov_outfile):
+    profraws = [os.path.join(log_path, name) for name in os.listdir(log_path) if name.endswith(".profraw")]
+    if not profraws:
+      logging.error("Test {} wrote no profile in {}.".format(test.name, log_path))
+      return False
+    profdata = os.path.join(log_path, "{}.profdata".format(test.name))
+    cmd = [self.configs.get("LlvmProfdata", "llvm-profdata"), "merge", "-sparse"] + profraws + ["-o", profdata]
+    logging.debug("Running {}".format(" ".join(cmd)))
+    ret = subprocess.run(cmd)
+    if ret.returncode != 0:
+      logging.error("Test {} llvm-profdata failed (returncode: {})".format(test.name, ret.returncode))
+      return False
+    raw_outfile = lcov_outfile + ".raw"
+    cmd = [self.configs.get("LlvmCov", "llvm-cov"), "export", "-format=lcov", "-instr-profile", profdata, test.bin_path]
+    logging.debug("Running {} > {}".format(" ".join(cmd), raw_outfile))
+    with open(raw_outfile, 'w') as fp:
+      ret = subprocess.run(cmd, stdout=fp)
+    if ret.returncode != 0:
+      logging.error("Test {} llvm-cov failed (returncode: {})".format(test.name, ret.returncode))
+      return False
+    found = ut_filter_lcov(raw_outfile, test.target_file, lcov_outfile)
+    os.remove(raw_outfile)
+    return found
+
+def ut_get_coverage_backend(configs):
+  backend = configs.get("CoverageBackend", "drcov")
+  if backend == "gcov":
+    return UtGcovBackend(configs)
+  if backend == "llvm-cov":
+    return UtLlvmCovBackend(configs)
+  return UtDrcovBackend(configs)
+
+def ut_read_lcov(lcov_file):
+  """
+  Returns the DA hit counts of an lcov file: {source file: {line: count}}.
+  """
+  counts = {}
+  src_file = None
+  with open(lcov_file) as fp:
+    for line in fp:
+      line = line.strip()
+      if line.startswith("SF:"):
+        src_file = line[3:]
+        counts.setdefault(src_file, {})
+      elif line.startswith("DA:") and src_file is not None:
+        fields = line[3:].split(",")
+        if len(fields) >= 2 and fields[1].isdigit():
+          number = int(fields[0])
+          counts[src_file][number] = counts[src_file].get(number, 0) + int(fields[1])
+      elif line == "end_of_record":
+        src_file = None
+  return counts
+
+def ut_lcov_percentage(lcov_file):
+  """
+  Returns the line coverage percentage string of an lcov file, as genhtml
+  prints it, or "NA".
+  """
+  found = 0
+  hit = 0
+  for lines in ut_read_lcov(lcov_file).values():
+    found += len(lines)
+    hit += sum(1 for count in lines.values() if count > 0)
+  if found == 0:
+    return "NA"
+  return "{:.1f}".format(100.0 * hit / found)
+
+def ut_coverage(configs, backend, test, log_path, out_path):
+  """
+  Converts the coverage logs of a test in log_path to lcov in out_path.
+  Returns the line coverage percentage string, or "NA".
+  """
+  lcov_outfile = os.path.join(out_path, "{}.coverage.info".format(test.name))
+  if not backend.export(test, log_path, lcov_outfile):
+    return "NA"
+  return ut_lcov_percentage(lcov_outfile)
+
+def ut_coverage_files(test):
+  """
+  Yields (iteration, lcov file) for the coverage info files of a test; the
+  iteration is None when the coverage is per test.
+  """
+  if test.coverage_per_test:
+    yield None, os.path.join(test.out_path, "{}.coverage.info".format(test.name))
+  else:
+    for iteration in test.iterations:
+      yield iteration, os.path.join(test.out_path, iteration, "{}.coverage.info".format(test.name))
+
+def ut_write_coverage_manifest(configs, components):
+  """
+  Lists the coverage info files produced, by target file, in OutPath, so
+  that the coverage report tool does not have to search for them.
+  The manifest of a previous run is merged in: the entries of the tests
+  not dispatched this time (e.g., --changed-files) are kept while their
+  files are.
+  """
+  dispatched = set(test.name for component in components for test in component.tests)
+  manifest_file = os.path.join(configs["OutPath"], COVERAGE_MANIFEST_FILE)
+  targets = {}
+  if os.path.isfile(manifest_file):
+    try:
+      with open(manifest_file) as fp:
+        manifest = json.load(fp)
+      if manifest.get("Version") == COVERAGE_MANIFEST_VERSION:
+        for target_file, entries in manifest["Targets"].items():
+          for entry in entries:
+            if entry["Test"] not in dispatched and \
+               os.path.isfile(os.path.join(configs["OutPath"], entry["Path"])):
+              targets.setdefault(target_file, []).append(entry)
+    except (ValueError, KeyError):
+      logging.warning("Ignoring corrupted coverage manifest {}.".format(manifest_file))
   for component in components:
     for test in component.tests:
-      if not os.path.isdir(test.out_path):
-         os.mkdir (test.out_path)
-      for iteration in test.iterations:
-        test_iter_out_path = os.path.join (test.out_path, iteration)
-        if not os.path.isdir (test_iter_out_path):
-          os.mkdir (test_iter_out_path)
-        test.status.append (None)
-        test.coverage.append ("NA")
-        try:
-          logging.debug ("Running {} -t drcov -- {} -i {} -o {} -c {}".format(drrun, test.bin_path, iteration, test_iter_out_path, test.cfg_path))
-          ret = subprocess.run([drrun, "-t", "drcov", "-logdir", test_iter_out_path,
-            "--", test.bin_path, "-i", iteration, "-o", test_iter_out_path, "-c", test.cfg_path], timeout=test.timeout)
-          if ret.returncode != 0:
-            logging.error("Test {} drrun failed (returncode: {})".format(test.name, ret.returncode))
-            continue
-        except subprocess.TimeoutExpired as err:
-          logging.error("Test {} drrun execution time expired (this is considered as a failure).")
-          continue
-        except Exception as err:
-          logging.error("Test {} drrun execution threw an exception (this is considered as a failure).")
-          logging.error(traceback.format_exc())
-          continue
+      for iteration, lcov_file in ut_coverage_files(test):
+        if os.path.isfile(lcov_file):
+          targets.setdefault(test.target_file, []).append({
+            "Test"      : test.name,
+            "Iteration" : iteration,
+            "Path"      : os.path.relpath(lcov_file, configs["OutPath"])
+          })
+  with open(manifest_file, 'w') as fp:
+    json.dump({"Version": COVERAGE_MANIFEST_VERSION, "Targets": targets}, fp, indent=2)
 
-        result_file = os.path.join(test_iter_out_path, test.name + JSON_EXTENSION)
-        if os.path.isfile (result_file):
-          test.status[-1] = get_test_status (result_file)
-        logging.debug("Test {} execution is over. Reported status is {}.".format(test.name, test.status[-1]))
-
-        drcov_logfile = find_drcov_log(test_iter_out_path)
-        lcov_outfile = os.path.join(test_iter_out_path, "{}.coverage.info".format(test.name))
-        logging.debug("Running {} -input {} -output {} -src_filter {}".format(drcov2lcov, drcov_logfile, lcov_outfile, test.target_file))
-        ret = subprocess.run([drcov2lcov, "-input", drcov_logfile, "-output", lcov_outfile, "-src_filter", test.target_file])
-        if ret.returncode != 0:
-          logging.error("Test {} drcov2lcov failed (returncode: {})".format(test.name, ret.returncode))
-          continue
-        logging.debug("Running {} {} {} -o {}".format(perl, genhtml, lcov_outfile, test_iter_out_path))
-        ret = subprocess.run([perl, genhtml, lcov_outfile, "-o", test_iter_out_path], stdout=subprocess.PIPE)
-        if ret.returncode != 0:
-          logging.error("genhtml for {} failed (returncode: {})".format(test.name, ret.returncode))
-          continue
-        # Very hacky way to get the coverage percentage
-        # FIX ME!
-        stdout_str = str(ret.stdout)
-        index0 = stdout_str.find("lines......: ")
-        if (index0 == -1):
-          continue
-        index1 = stdout_str[index0+13:].find("%")
-        if (index1 == -1):
+def ut_coverage_report(configs, components):
+  """
+  Merges the coverage of all dispatched tests and renders it with a single
+  genhtml run in OutPath. Returns the report index path relative to
+  OutPath, or None.
+  """
+  lcov_files = [lcov_file for component in components for test in component.tests
+    for _, lcov_file in ut_coverage_files(test) if os.path.isfile(lcov_file)]
+  if not lcov_files:
+    return None
+
+  report_dir = os.path.join(configs["OutPath"], COVERAGE_REPORT_DIR)
+  if not os.path.isdir(report_dir):
+    os.mkdir(report_dir)
+  lcov_outfile = os.path.join(report_dir, "coverage.info")
+  ut_combine_coverage_info_files(lcov_files, lcov_outfile)
+
+  genhtml = ut_get_coverage_backend(configs).genhtml()
+  logging.debug("Running {} {} -o {}".format(" ".join(genhtml), lcov_outfile, report_dir))
+  ret = subprocess.run(genhtml + [lcov_outfile, "-o", report_dir], stdout=subprocess.PIPE)
+  if ret.returncode != 0:
+    logging.error("genhtml for {} failed (returncode: {})".format(lcov_outfile, ret.returncode))
+    return None
+  return "./{}/index.html".format(COVERAGE_REPORT_DIR)
+
+class UtHistory():
+  """
+  Durations of the test iterations in previous dispatcher runs, in seconds.
+  """
+  def __init__(self, path):
+    self.path      = path
+    self.durations = {}
+    self.longest   = 0     # Longest duration recorded in this run
+    self.lock      = threading.Lock()
+    if os.path.isfile(path):
+      try:
+        with open(path) as fp:
+          self.durations = json.load(fp)
+      except ValueError:
+        logging.warning("Ignoring corrupted history file {}.".format(path))
+
+  @staticmethod
+  def key(test, iteration):
+    return "{}/{}".format(test.name, iteration)
+
+  def estimate(self, test, iteration):
+    # Without history, assume the worst: the iteration runs until its timeout.
+    default = test.timeout if test.timeout else max(self.durations.values(), default=0)
+    return self.durations.get(self.key(test, iteration), default)
+
+  def record(self, test, iteration, duration):
+    with self.lock:
+      self.durations[self.key(test, iteration)] = round(duration, 3)
+      self.longest = max(self.longest, duration)
+
+  def save(self):
+    with open(self.path, 'w') as fp:
+      json.dump(self.durations, fp, indent=2, sort_keys=True)
+
+def ut_schedule(jobs, history, run):
+  """
+  Orders the (test, index, iteration) jobs longest first according to the
+  history (longest-processing-time-first), and wraps run so it records the
+  duration of every job. Started last, the slowest iterations would
+  otherwise set the end of the whole run.
+  """
+  jobs = sorted(jobs, key=lambda job: history.estimate(job[0], job[2]), reverse=True)
+
+  def timed_run(test, index, iteration):
+    start = time.monotonic()
+    try:
+      return run(test, index, iteration)
+    finally:
+      history.record(test, iteration, time.monotonic() - start)
+
+  return jobs, timed_run
+
+class UtResultCache():
+  """
+  Results of test iterations, keyed by a hash of everything they depend on:
+  the test binary, its config JSON, the files the iteration config names
+  (e.g. its FakeImage), the iteration name and the target source file. An
+  entry is a copy of the iteration output folder (log, result JSON, coverage
+  info and report, without the drcov logs) plus the status and coverage to
+  report. The least recently used entries are removed once the cache grows
+  over max_bytes.
+  """
+  def __init__(self, path, max_bytes):
+    self.path        = path
+    self.max_bytes   = max_bytes
+    self.entries     = {}    # key: [size, last use]
+    self.file_hashes = {}
+    self.cfg_files   = {}    # (config file, iteration): [referenced file]
+    self.lock        = threading.Lock()
+    if not os.path.isdir(path):
+      os.makedirs(path)
+    for key in os.listdir(path):
+      meta_file = os.path.join(path, key, CACHE_META_FILE)
+      if os.path.isfile(meta_file):
+        self.entries[key] = [self._size(os.path.join(path, key)), os.path.getmtime(meta_file)]
+      else:
+        # Left over by an interrupted store
+        shutil.rmtree(os.path.join(path, key), ignore_errors=True)
+
+  @staticmethod
+  def _size(path):
+    return sum(os.path.getsize(os.path.join(root, name)) for root, _, names in os.walk(path) for name in names)
+
+  def _hash_file(self, path):
+    # Binaries are shared by all iterations of a test: hash each file once.
+    with self.lock:
+      if path in self.file_hashes:
+        return self.file_hashes[path]
+    digest = hashlib.sha256()
+    if os.path.isfile(path):
+      with open(path, 'rb') as fp:
+        for block in iter(lambda: fp.read(1 << 20), b''):
+          digest.update(block)
+    else:
+      digest.update(b'<missing>')
+    with self.lock:
+      self.file_hashes[path] = digest.hexdigest()
+    return self.file_hashes[path]
+
+  def _referenced_files(self, cfg_path, iteration):
+    """
+    Returns the files named by the iteration entry of a test config JSON: its
+    FakeImage, and any other string value naming an existing file. Relative
+    paths are relative to the config file, as in the test binary.
+    """
+    with self.lock:
+      if (cfg_path, iteration) in self.cfg_files:
+        return self.cfg_files[(cfg_path, iteration)]
+    files = []
+    try:
+      with open(cfg_path) as fp:
+        entries = json.load(fp)
+    except (OSError, ValueError):
+      entries = []
+    for entry in entries if isinstance(entries, list) else []:
+      if not isinstance(entry, dict) or entry.get("Iteration") != iteration:
+        continue
+      values = list(entry.items())
+      while values:
+        name, value = values.pop()
+        if isinstance(value, dict):
+          values.extend(value.items())
+        elif isinstance(value, list):
+          values.extend((name, item) for item in value)
+        elif isinstance(value, str) and value:
+          path = os.path.join(os.path.dirname(cfg_path), value.replace("\\", "/"))
+          if name == FAKE_IMAGE_KEY or os.path.isfile(path):
+            files.append(path)
+    with self.lock:
+      self.cfg_files[(cfg_path, iteration)] = sorted(files)
+    return self.cfg_files[(cfg_path, iteration)]
+
+  def key(self, configs, test, iteration):
+    digest = hashlib.sha256()
+    digest.update(json.dumps([CACHE_VERSION, configs.get("CoverageBackend", "drcov"), test.name, test.bin_args,
+      iteration, test.target_file]).encode())
+    digest.update(self._hash_file(test.bin_path).encode())
+    digest.update(self._hash_file(test.cfg_path).encode())
+    for path in self._referenced_files(test.cfg_path, iteration):
+      digest.update(self._hash_file(path).encode())
+    digest.update(self._hash_file(os.path.join(configs["RepoPath"], test.target_file.replace("\\", "/"))).encode())
+    return digest.hexdigest()
+
+  def load(self, key, out_path):
+    """
+    Restores a cached iteration output folder in out_path.
+    Returns (status, coverage), or None on a miss.
+    """
+    with self.lock:
+      if key not in self.entries:
+        return None
+      self.entries[key][1] = time.time()
+    entry = os.path.join(self.path, key)
+    meta_file = os.path.join(entry, CACHE_META_FILE)
+    try:
+      with open(meta_file) as fp:
+        meta = json.load(fp)
+      shutil.copytree(entry, out_path, dirs_exist_ok=True, ignore=shutil.ignore_patterns(CACHE_META_FILE))
+      os.utime(meta_file)
+    except (OSError, ValueError):
+      logging.warning("Dropping unreadable cache entry {}.".format(entry))
+      with self.lock:
+        self.entries.pop(key, None)
+      shutil.rmtree(entry, ignore_errors=True)
+      return None
+    return meta["Status"], meta["Coverage"]
+
+  def store(self, key, out_path, status, coverage):
+    entry = os.path.join(self.path, key)
+    tmp_entry = "{}.{}.tmp".format(entry, threading.get_ident())
+    try:
+      shutil.copytree(out_path, tmp_entry, ignore=shutil.ignore_patterns("drcov*.log"))
+      with open(os.path.join(tmp_entry, CACHE_META_FILE), 'w') as fp:
+        json.dump({"Status": status, "Coverage": coverage}, fp)
+      size = self._size(tmp_entry)
+      with self.lock:
+        if key in self.entries:
+          shutil.rmtree(tmp_entry, ignore_errors=True)
+          return
+        os.rename(tmp_entry, entry)
+        self.entries[key] = [size, time.time()]
+        self._evict()
+    except OSError:
+      logging.warning("Could not store {} in the result cache.".format(out_path))
+      shutil.rmtree(tmp_entry, ignore_errors=True)
+
+  def _evict(self):
+    total = sum(size for size, _ in self.entries.values())
+    for key in sorted(self.entries, key=lambda k: self.entries[k][1]):
+      if total <= self.max_bytes:
+        break
+      total -= self.entries.pop(key)[0]
+      shutil.rmtree(os.path.join(self.path, key), ignore_errors=True)
+
+def ut_read_lcov_lines(lcov_file):
+  """
+  Returns the lines executed at least once per source file of an lcov file.
+  """
+  return {src_file: set(number for number, count in lines.items() if count > 0)
+    for src_file, lines in ut_read_lcov(lcov_file).items()}
+
+def ut_line_ranges(lines):
+  ranges = []
+  for line in sorted(lines):
+    if ranges and line == ranges[-1][1] + 1:
+      ranges[-1][1] = line
+    else:
+      ranges.append([line, line])
+  return ranges
+
+class UtImpactMap():
+  """
+  Source line ranges executed by each test iteration in previous runs, taken
+  from the iteration coverage info, which only covers the test target file.
+  Selects the iterations a change impacts. Source paths are kept relative to
+  the repo, lower case, with '/'.
+  """
+  def __init__(self, path, repo_path):
+    self.path       = path
+    self.repo_path  = os.path.abspath(repo_path).replace("\\", "/").lower().rstrip("/") + "/"
+    self.iterations = {}    # "Test/Iteration": {src_file: [[first, last], ...]}
+    self.lock       = threading.Lock()
+    if os.path.isfile(path):
+      try:
+        with open(path) as fp:
+          self.iterations = json.load(fp)
+      except ValueError:
+        logging.warning("Ignoring corrupted impact map {}.".format(path))
+
+  def normalize(self, src_file):
+    src_file = src_file.replace("\\", "/").lower()
+    if src_file.startswith(self.repo_path):
+      src_file = src_file[len(self.repo_path):]
+    return src_file
+
+  def record(self, test, iterations, lcov_file):
+    """
+    Replaces what the iterations are known to execute with the lines
+    covered in lcov_file.
+    """
+    if not os.path.isfile(lcov_file):
+      return
+    files = {}
+    for src_file, lines in ut_read_lcov_lines(lcov_file).items():
+      if lines:
+        files[self.normalize(src_file)] = ut_line_ranges(lines)
+    with self.lock:
+      for iteration in iterations:
+        self.iterations[UtHistory.key(test, iteration)] = files
+
+  def is_impacted(self, test, iteration, changes):
+    """
+    changes maps changed source files to their changed line ranges, or to
+    None when any line may have changed.
+    """
+    files = self.iterations.get(UtHistory.key(test, iteration))
+    if files is None:
+      # Never mapped: nothing says the change does not impact it.
+      return True
+    for src_file, changed_ranges in changes.items():
+      if src_file not in files:
+        continue
+      if changed_ranges is None:
+        return True
+      for first, last in files[src_file]:
+        for changed_first, changed_last in changed_ranges:
+          if changed_first <= last and first <= changed_last:
+            return True
+    return False
+
+  def save(self):
+    with open(self.path, 'w') as fp:
+      json.dump(self.iterations, fp, sort_keys=True)
+
+def ut_read_changes(impact_map, changed_files, diff_file):
+  """
+  Returns the changes to select impacted iterations for, from a list of
+  changed files and/or a unified diff (e.g., git diff -U0 output). Changed
+  line ranges are those of the old file, which the impact map refers to.
+  """
+  changes = {}
+  for changed_file in changed_files or []:
+    changes[impact_map.normalize(changed_file)] = None
+  if diff_file:
+    src_file = None
+    with open(diff_file) as fp:
+      for line in fp:
+        if line.startswith("--- "):
+          src_file = line[4:].strip()
+          if src_file.startswith("a/"):
+            src_file = src_file[2:]
+          src_file = None if src_file == "/dev/null" else impact_map.normalize(src_file)
+        elif line.startswith("+++ ") and src_file is None:
+          # New file: no iteration can have executed it.
           continue
-        test.coverage[-1] = stdout_str[index0+13:index0+13+index1]
+        elif line.startswith("@@") and src_file is not None:
+          match = re.match(r"@@ -(\d+)(?:,(\d+))? ", line)
+          if match is None:
+            changes[src_file] = None
+            continue
+          first = int(match.group(1))
+          count = 1 if match.group(2) is None else int(match.group(2))
+          # A pure insertion (count 0) goes after line first: the lines around it are impacted.
+          last = first + count - 1 if count > 0 else first + 1
+          if changes.get(src_file, []) is not None:
+            changes.setdefault(src_file, []).append([first, last])
+  return changes
+
+def ut_select_impacted(components, impact_map, changes):
+  """
+  Keeps only the iterations impacted by the changes. A change in a test's
+  own folder (its source, stubs or config) or in a file that may affect any
+  test (see IMPACT_GLOBAL_EXTENSIONS) keeps all iterations of the tests
+  concerned. So does a change in a source file outside the test folders
+  that is not a test target (e.g., a fake or UtBaseLib): the impact map does
+  not record its lines. Target files impact the iterations that executed
+  them.
+  """
+  tests = [test for component in components for test in component.tests]
+  targets = set(impact_map.normalize(test.target_file) for test in tests if test.target_file)
+  test_dirs = tuple(impact_map.normalize(test.src_dir) + "/" for test in tests if test.src_dir)
+  global_change = any(src_file.endswith(IMPACT_GLOBAL_EXTENSIONS) or
+    (src_file.endswith(IMPACT_SOURCE_EXTENSIONS) and src_file not in targets and not src_file.startswith(test_dirs))
+    for src_file in changes)
+  selected_components = []
+  for component in components:
+    selected_tests = []
+    for test in component.tests:
+      test_dir = impact_map.normalize(test.src_dir) + "/" if test.src_dir else None
+      if global_change or (test_dir and any(src_file.startswith(test_dir) for src_file in changes)):
+        selected_tests.append(test)
+        continue
+      test.iterations = [iteration for iteration in test.iterations
+        if impact_map.is_impacted(test, iteration, changes)]
+      if test.iterations:
+        selected_tests.append(test)
+    if selected_tests:
+      component.tests = selected_tests
+      selected_components.append(component)
+  count = sum(len(test.iterations) for component in selected_components for test in component.tests)
+  logging.info("{} test iteration(s) impacted by the changes.".format(count))
+  return selected_components
+
+def ut_run_jobs(jobs, max_jobs, run, post_process=None):
+  """
+  Calls run(*job) for every job on max_jobs threads; each of them only waits
+  on test processes. Idle threads take the next job from the executor's
+  shared queue, in the order of jobs. At most 2 * max_jobs jobs are queued
+  at a time, so the memory used does not grow with the size of the profile.
+
+  When run returns a tuple, post_process is called with it on a separate
+  pool of max_jobs threads (e.g., for coverage conversion), so that test
+  execution goes on meanwhile.
+  """
+  with concurrent.futures.ThreadPoolExecutor(max_workers=max_jobs) as executor, \
+       concurrent.futures.ThreadPoolExecutor(max_workers=max_jobs) as post_executor:
+    pending = set()
+    post_pending = []
+
+    def collect(done):
+      for future in done:
+        post_args = future.result()
+        if post_process is not None and post_args is not None:
+          post_pending.append(post_executor.submit(post_process, *post_args))
+
+    for job in jobs:
+      if len(pending) >= 2 * max_jobs:
+        done, pending = concurrent.futures.wait(pending, return_when=concurrent.futures.FIRST_COMPLETED)
+        collect(done)
+      pending.add(executor.submit(run, *job))
+    collect(concurrent.futures.as_completed(pending))
+    for future in post_pending:
+      future.result()
+
+def ut_prepare_test(test):
+  """
+  Creates the output directories of a test, one per iteration, and the
+  result slots its iterations fill in whatever order they finish.
+  """
+  if not os.path.isdir(test.out_path):
+     os.mkdir (test.out_path)
+  test.status   = [None] * len(test.iterations)
+  test.coverage = ["NA"] * len(test.iterations)
+  for iteration in test.iterations:
+    test_iter_out_path = os.path.join (test.out_path, iteration)
+    if not os.path.isdir (test_iter_out_path):
+      os.mkdir (test_iter_out_path)
+
+def ut_dispatch_workers(configs, components, jobs, history, impact_map=None):
+  """
+  Runs the iterations of each test in warm workers (test binaries started
+  with --worker) instead of one process per iteration. A worker covers
+  many iterations, so coverage is reported per test, and post-processed
+  once its last iteration is over.
+  """
+  backend = ut_get_coverage_backend(configs)
+  pool = UtWorkerPool(configs.get("WorkersPerBinary") or os.cpu_count() or 1)
+  remaining = {}
+  lock = threading.Lock()
+
+  def run_iteration(test, index, iteration):
+    cmd, env = backend.wrap(test, [test.bin_path] + test.bin_args + ["--worker", "-c", test.cfg_path], test.out_path)
+    test_iter_out_path = os.path.join (test.out_path, iteration)
+    try:
+      logging.debug ("Requesting {} (Iteration: {}) from worker {}".format(test.name, iteration, " ".join(cmd)))
+      request = {"Iteration": iteration, "OutPath": test_iter_out_path}
+      if test.timeout:
+        request["Timeout"] = test.timeout
+      response = pool.run(cmd, request, test.timeout + WATCHDOG_GRACE if test.timeout else None, dict(os.environ, **env))
+      if "Error" in response:
+        logging.error("Test {} worker rejected the request: {}".format(test.name, response["Error"]))
+      elif response.get("Status") == "TIMEOUT":
+        logging.error("Test {} (Iteration: {}) timed out (this is considered as a failure).".format(test.name, iteration))
+      result_file = os.path.join(test_iter_out_path, test.name + JSON_EXTENSION)
+      if os.path.isfile (result_file):
+        test.status[index] = get_test_status (result_file)
+      logging.debug("Test {} execution is over. Reported status is {}.".format(test.name, test.status[index]))
+    except subprocess.TimeoutExpired as err:
+      logging.error("Test {} worker execution time expired (this is considered as a failure).".format(test.name))
+    except Exception as err:
+      logging.error("Test {} worker execution threw an exception (this is considered as a failure).".format(test.name))
+      logging.error(traceback.format_exc())
+
+    with lock:
+      remaining[test] -= 1
+      last = remaining[test] == 0
+    if last:
+      # The workers write their coverage logs as they exit.
+      pool.close(cmd)
+      return (test,)
+
+  def post_process(test):
+    coverage = ut_coverage(configs, backend, test, test.out_path, test.out_path)
+    test.coverage = [coverage] * len(test.iterations)
+    if impact_map is not None:
+      impact_map.record(test, test.iterations, os.path.join(test.out_path, "{}.coverage.info".format(test.name)))
+
+  def all_iterations():
+    for component in components:
+      for test in component.tests:
+        ut_prepare_test(test)
+        backend.clean(test, test.out_path)
+        test.coverage_per_test = True
+        remaining[test] = len(test.iterations)
+        for index, iteration in enumerate(test.iterations):
+          yield test, index, iteration
+
+  scheduled, timed_run = ut_schedule(all_iterations(), history, run_iteration)
+  ut_run_jobs(scheduled, jobs, timed_run, post_process)
+
+def ut_dispatch(configs, components, jobs, history, cache=None, impact_map=None):
+  """
+  Runs every test iteration in its own process and output directory, up to
+  jobs of them at a time, and reports coverage per iteration; coverage is
+  converted in a post-processing stage while the next iterations run.
+  Iterations found in the result cache are restored instead of run.
+  """
+  backend = ut_get_coverage_backend(configs)
+
+  def run_iteration(test, index, iteration):
+    test_iter_out_path = os.path.join (test.out_path, iteration)
+    watchdog_args = ["-w", str(test.timeout)] if test.timeout else []
+    cmd, env = backend.wrap(test, [test.bin_path] + test.bin_args + ["-i", iteration, "-o", test_iter_out_path, "-c", test.cfg_path] + watchdog_args, test_iter_out_path)
+    backend.clean(test, test_iter_out_path)
+    try:
+      logging.debug ("Running {}".format(" ".join(cmd)))
+      ret = subprocess.run(cmd, env=dict(os.environ, **env), timeout=test.timeout + WATCHDOG_GRACE if test.timeout else None)
+      if ret.returncode == TIMEOUT_RETURNCODE:
+        # The test wrote its result and log before exiting: report them.
+        logging.error("Test {} (Iteration: {}) timed out (this is considered as a failure).".format(test.name, iteration))
+      elif ret.returncode != 0:
+        logging.error("Test {} run failed (returncode: {})".format(test.name, ret.returncode))
+        return
+    except subprocess.TimeoutExpired as err:
+      logging.error("Test {} execution time expired (this is considered as a failure).".format(test.name))
+      return
+    except Exception as err:
+      logging.error("Test {} execution threw an exception (this is considered as a failure).".format(test.name))
+      logging.error(traceback.format_exc())
+      return
+
+    result_file = os.path.join(test_iter_out_path, test.name + JSON_EXTENSION)
+    if os.path.isfile (result_file):
+      test.status[index] = get_test_status (result_file)
+    logging.debug("Test {} execution is over. Reported status is {}.".format(test.name, test.status[index]))
+    return test, index, iteration
+
+  def post_process(test, index, iteration):
+    test_iter_out_path = os.path.join (test.out_path, iteration)
+    test.coverage[index] = ut_coverage(configs, backend, test, test_iter_out_path, test_iter_out_path)
+    if impact_map is not None:
+      impact_map.record(test, [iteration], os.path.join(test_iter_out_path, "{}.coverage.info".format(test.name)))
+
+    # Iterations that did not report a status (e.g., crashed) or timed out are run again next time.
+    if cache is not None and test.status[index] not in (None, "TIMEOUT"):
+      cache.store(cache.key(configs, test, iteration), test_iter_out_path, test.status[index], test.coverage[index])
+
+  def all_iterations():
+    for component in components:
+      for test in component.tests:
+        ut_prepare_test(test)
+        for index, iteration in enumerate(test.iterations):
+          if cache is not None:
+            cached = cache.load(cache.key(configs, test, iteration), os.path.join(test.out_path, iteration))
+            if cached is not None:
+              test.status[index], test.coverage[index] = cached
+              if impact_map is not None:
+                impact_map.record(test, [iteration], os.path.join(test.out_path, iteration, "{}.coverage.info".format(test.name)))
+              logging.debug("Test {} (Iteration: {}) is unchanged. Cached status is {}.".format(test.name, iteration, test.status[index]))
+              continue
+          yield test, index, iteration
+
+  scheduled, timed_run = ut_schedule(all_iterations(), history, run_iteration)
+  ut_run_jobs(scheduled, jobs, timed_run, post_process)
 
 def ut_get_platform (profile):
   with open(profile) as fp:
@@ -167,7 +1073,13 @@ def ut_get_all_components(configs):
         ut = Ut()
         ut.name     = test["Name"]
         ut.bin_path = os.path.join(inpath, ut.name + BINARY_EXTENSION)
+        # Test hosted by a test table binary (see UtRunTestTable)
+        if "Binary" in test:
+          ut.bin_path = os.path.join(inpath, test["Binary"] + BINARY_EXTENSION)
+          ut.bin_args = ["-t", ut.name]
         ut.cfg_path = os.path.join(inpath, ut.name + JSON_EXTENSION)
+        if "ConfigFile" in test:
+          ut.src_dir = os.path.dirname(test["ConfigFile"].replace("\\", "/"))
         ut.out_path = os.path.join(outpath, ut.name)
         ut.timeout  = test["Timeout"]
         ut.target_file = test["Target"]
@@ -216,19 +1128,25 @@ def ut_get_configs(config_file):
     logging.error("Repo directory (i.e., {}) does not exist.".format(configs["RepoPath"]))
     sys.exit(1)
 
-  if 'PerlPath' not in configs:
-    logging.error("Configuration parameter 'PerlPath' not found. 'PerlPath' parameter is mandatory.")
-    sys.exit(1)
-  if not os.path.isdir(configs["PerlPath"]):
-    logging.error("Perl directory (i.e., {}) does not exist.".format(configs["PerlPath"]))
+  if configs.get("CoverageBackend", "drcov") not in COVERAGE_BACKENDS:
+    logging.error("Unknown 'CoverageBackend' {}. Supported backends: {}.".format(configs["CoverageBackend"], ", ".join(COVERAGE_BACKENDS)))
     sys.exit(1)
 
-  if 'DynamoRioPath' not in configs:
-    logging.error("Configuration parameter 'DynamoRioPath' not found. 'DynamoRioPath' parameter is mandatory.")
-    sys.exit(1)
-  if not os.path.isdir(configs["DynamoRioPath"]):
-    logging.error("DynamoRio directory (i.e., {}) does not exist.".format(configs["DynamoRioPath"]))
-    sys.exit(1)
+  # DynamoRio and the Perl it runs genhtml with are only needed by the drcov backend.
+  if configs.get("CoverageBackend", "drcov") == "drcov":
+    if 'PerlPath' not in configs:
+      logging.error("Configuration parameter 'PerlPath' not found. 'PerlPath' parameter is mandatory.")
+      sys.exit(1)
+    if not os.path.isdir(configs["PerlPath"]):
+      logging.error("Perl directory (i.e., {}) does not exist.".format(configs["PerlPath"]))
+      sys.exit(1)
+
+    if 'DynamoRioPath' not in configs:
+      logging.error("Configuration parameter 'DynamoRioPath' not found. 'DynamoRioPath' parameter is mandatory.")
+      sys.exit(1)
+    if not os.path.isdir(configs["DynamoRioPath"]):
+      logging.error("DynamoRio directory (i.e., {}) does not exist.".format(configs["DynamoRioPath"]))
+      sys.exit(1)
 
   if 'TestProfile' not in configs:
     logging.error("Configuration parameter 'TestProfile' not found. 'TestProfile' parameter is mandatory.")
@@ -253,7 +1171,36 @@ if __name__ == "__main__":
     help="Relative path to the JSON configuration file for this script"
   )
 
+  parser.add_argument(
+    "-j", "--jobs",
+    type=int,
+    default=os.cpu_count() or 1,
+    help="Number of test iterations to run in parallel (default: number of cores)"
+  )
+
+  parser.add_argument(
+    "--no-cache",
+    action="store_true",
+    help="Run every test iteration, without reading or updating the result cache"
+  )
+
+  parser.add_argument(
+    "--changed-files",
+    nargs="+",
+    metavar="FILE",
+    help="Run only the test iterations impacted by changes to these files (repo relative paths)"
+  )
+
+  parser.add_argument(
+    "--diff",
+    metavar="DIFF_FILE",
+    help="Run only the test iterations impacted by this unified diff (e.g., git diff -U0 output)"
+  )
+
   args = parser.parse_args()
+  if args.jobs < 1:
+    logging.error("The number of jobs must be at least 1.")
+    sys.exit(1)
 
   config_file = os.path.join(script_dir, args.ConfigFile)
   if not os.path.isfile(config_file):
@@ -279,8 +1226,40 @@ if __name__ == "__main__":
   # Get all test componenets
   all_components = ut_get_all_components(configs)
 
+  # Iteration durations of the previous runs, kept next to their output folders
+  history_file = configs.get("HistoryFile") or \
+    os.path.join(os.path.dirname(os.path.abspath(configs["OutPath"])), HISTORY_FILE)
+  history = UtHistory(history_file)
+
+  # Results of unchanged test iterations, shared by the runs like the history
+  cache = None
+  if not args.no_cache:
+    cache_dir = configs.get("CacheDir") or \
+      os.path.join(os.path.dirname(os.path.abspath(configs["OutPath"])), CACHE_DIR)
+    cache = UtResultCache(cache_dir, configs.get("CacheSizeMB", CACHE_DEFAULT_SIZE_MB) * 1024 * 1024)
+
+  # Source lines executed by every iteration, to run only what a change impacts
+  impact_map_file = configs.get("ImpactMapFile") or \
+    os.path.join(os.path.dirname(os.path.abspath(configs["OutPath"])), IMPACT_MAP_FILE)
+  impact_map = UtImpactMap(impact_map_file, configs["RepoPath"])
+  if args.changed_files or args.diff:
+    changes = ut_read_changes(impact_map, args.changed_files, args.diff)
+    all_components = ut_select_impacted(all_components, impact_map, changes)
+
   # Run the tests
-  ut_dispatch(configs, all_components)
+  start = time.monotonic()
+  if configs.get("UseWorkers", False):
+    ut_dispatch_workers(configs, all_components, args.jobs, history, impact_map)
+  else:
+    ut_dispatch(configs, all_components, args.jobs, history, cache, impact_map)
+  history.save()
+  impact_map.save()
+
+  # Render the coverage of all tests at once
+  coverage_report = ut_coverage_report(configs, all_components)
+  ut_write_coverage_manifest(configs, all_components)
+  logging.info("Tests dispatched in {:.1f}s (longest iteration: {:.1f}s).".format(
+    time.monotonic() - start, history.longest))
 
   # Save test information
   test_info = {}
@@ -302,6 +1281,7 @@ if __name__ == "__main__":
       configs=configs,
       platform=platform,
       components=all_components,
+      coverage_report=coverage_report,
       completion_time=completion_time
       )
     )
@@ -0,0 +1,104 @@
+# Copyright 2024 Advanced Micro Devices, Inc. All rights reserved.
+# SPDX-License-Identifier: MIT
+
+"""
+Builds and inspects register images for the fake address spaces of
+UtFakeMemLib (see UT_FAKE_IMAGE_HEADER in UtFakeMemLib.h).
+
+  fake_image.py build -o FchGenoa.utfi MMIO:0xFED80000:acpimmio.bin PCIE:0xE0000000:ecam_bus0.bin
+  fake_image.py dump FchGenoa.utfi
+
+Where regions overlap, the one listed last wins, and so does the image
+loaded last (see UtFakeImageLoad).
+"""
+
+import os
+import sys
+import struct
+import logging
+import argparse
+
+UT_FAKE_IMAGE_SIGNATURE = 0x49465455 # "UTFI"
+UT_FAKE_IMAGE_VERSION   = 1
+UT_FAKE_PAGE_SIZE       = 0x1000
+UT_FAKE_SPACES          = ["MMIO", "IO", "PCIE", "SMN"]
+
+HEADER = struct.Struct("<IHHII")      # Signature, Version, HeaderSize, RegionCount, RegionOffset
+REGION = struct.Struct("<16sQQQ")     # Space, Base, Length, DataOffset
+
+def align_up(value, alignment):
+  return (value + alignment - 1) & ~(alignment - 1)
+
+def parse_region(arg):
+  """
+  Parses SPACE:BASE:FILE (FILE may itself contain ':' on Windows).
+  """
+  parts = arg.split(":", 2)
+  if len(parts) != 3:
+    raise argparse.ArgumentTypeError("Region '{}' is not SPACE:BASE:FILE.".format(arg))
+  space, base, path = parts
+  if len(space.encode("ascii")) > 16:
+    raise argparse.ArgumentTypeError("Space name '{}' is longer than 16 characters.".format(space))
+  if space not in UT_FAKE_SPACES:
+    logging.warning("Space '{}' is not one of the standard fake spaces {}.".format(space, UT_FAKE_SPACES))
+  if not os.path.isfile(path):
+    raise argparse.ArgumentTypeError("Dump file '{}' does not exist.".format(path))
+  return space, int(base, 0), path
+
+def build_image(out_file, regions):
+  region_offset = HEADER.size
+  data_offset   = align_up(region_offset + REGION.size * len(regions), UT_FAKE_PAGE_SIZE)
+  table         = []
+  for space, base, path in regions:
+    length = os.path.getsize(path)
+    table.append((space, base, length, data_offset, path))
+    data_offset = align_up(data_offset + length, UT_FAKE_PAGE_SIZE)
+
+  with open(out_file, "wb") as fp:
+    fp.write(HEADER.pack(UT_FAKE_IMAGE_SIGNATURE, UT_FAKE_IMAGE_VERSION, HEADER.size, len(table), region_offset))
+    for space, base, length, offset, _ in table:
+      fp.write(REGION.pack(space.encode("ascii"), base, length, offset))
+    for space, base, length, offset, path in table:
+      fp.seek(offset)
+      with open(path, "rb") as dump:
+        fp.write(dump.read())
+      logging.info("{:<5} 0x{:016X} - 0x{:016X} <- {}".format(space, base, base + length - 1, path))
+    fp.truncate(align_up(fp.tell(), UT_FAKE_PAGE_SIZE))
+
+def dump_image(image_file):
+  with open(image_file, "rb") as fp:
+    signature, version, header_size, count, region_offset = HEADER.unpack(fp.read(HEADER.size))
+    if signature != UT_FAKE_IMAGE_SIGNATURE or version != UT_FAKE_IMAGE_VERSION:
+      logging.error("{} is not a version {} register image.".format(image_file, UT_FAKE_IMAGE_VERSION))
+      sys.exit(1)
+    fp.seek(region_offset)
+    for _ in range(count):
+      space, base, length, offset = REGION.unpack(fp.read(REGION.size))
+      print("{:<5} 0x{:016X} - 0x{:016X} (file offset 0x{:X})".format(
+        space.rstrip(b"\0").decode("ascii"), base, base + length - 1, offset))
+
+if __name__ == "__main__":
+
+  logging.basicConfig(format="%(levelname)s: %(message)s", level=logging.INFO)
+
+  parser = argparse.ArgumentParser(description="Build or inspect UtFakeMemLib register images.")
+  subparsers = parser.add_subparsers(dest="command", required=True)
+
+  build_parser = subparsers.add_parser("build", help="Build an image from raw register dumps")
+  build_parser.add_argument("-o", "--output", required=True, help="Image file to create")
+  build_parser.add_argument(
+    "regions",
+    nargs="+",
+    type=parse_region,
+    help="SPACE:BASE:FILE, e.g. MMIO:0xFED80000:acpimmio.bin; where regions overlap, the last one wins"
+  )
+
+  dump_parser = subparsers.add_parser("dump", help="List the regions of an image")
+  dump_parser.add_argument("image", help="Image file")
+
+  args = parser.parse_args()
+
+  if args.command == "build":
+    build_image(args.output, args.regions)
+  else:
+    dump_image(args.image)